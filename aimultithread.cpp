@@ -1,13 +1,21 @@
 #include "aimultithread.h"
 #include "chessboard.h"
+#include "engineoptions.h"
+
+#include <algorithm>
 
 AIMultiThread::AIMultiThread(QObject *parent)
     : QObject{parent}
 {}
 
-AIMultiThread::AIMultiThread(ChessBoard b, Team t) {
+AIMultiThread::AIMultiThread(ChessBoard b, Team t, TranspositionTable * table, const std::vector<uint64_t> &history,
+                             QThreadPool * pool, const std::vector<int> &cpus) {
     this->board = b;
     this->team = t;
+    this->table = table;
+    this->history = history;
+    this->pool = pool ? pool : QThreadPool::globalInstance();
+    this->cpus = cpus;
     this->future_checking_timer = new QTimer();
 }
 
@@ -18,15 +26,52 @@ AIMultiThread::~AIMultiThread() {
 void AIMultiThread::start() {
     this->children = board.gen_filtered_children_boards(team);
     num_finished_futures = 0;
+    reported_iterations = 0;
+    iteration_scores.assign(children.size(), {});
+    history.push_back(board.key(team));
     for(int i = 0; i < children.size(); i++) {
-        futures.push_back(QtConcurrent::run([=]{
-            return children[i].alpha_beta(team_inverse(team));
+        futures.push_back(QtConcurrent::run(pool, [=]{
+            pin_engine_thread(cpus);
+            ChessBoard child = children[i];
+            //each child is its own search root, where alpha_beta does not look for repeats
+            if(std::optional<int> draw = child.rule_draw_score(team_inverse(team), history)) return *draw;
+            return child.search(team_inverse(team), SearchLimits(), table, nullptr, [this, i](const SearchResult &iteration) {
+                QMutexLocker locker(&iteration_mutex);
+                iteration_scores[i].push_back({iteration.depth + 1, iteration.score});
+            }, history).score;
         }));
     }
     this->connect(this->future_checking_timer, &QTimer::timeout, this, &AIMultiThread::check_futures);
     future_checking_timer->start(200);
 }
 
+bool AIMultiThread::better(int a, int b) {
+    return team == Team::Alpha ? a > b : a < b;
+}
+
+//emits every depth that all children have now completed, a finished child counts with its final score
+void AIMultiThread::report_iterations() {
+    QMutexLocker locker(&iteration_mutex);
+    while(true) {
+        std::optional<std::pair<int, int>> best;
+        bool deeper = false;
+        for(int i = 0; i < iteration_scores.size(); i++) {
+            std::pair<int, int> child_score;
+            if(iteration_scores[i].size() > reported_iterations) {
+                child_score = iteration_scores[i][reported_iterations];
+                deeper = true;
+            }
+            else if(futures[i].isFinished()) child_score = {0, futures[i].result()};//mate or stalemate, no iterations
+            else return;
+            if(!best || better(child_score.second, best->second)) best = {std::max(child_score.first, best ? best->first : 0), child_score.second};
+            else best->first = std::max(best->first, child_score.first);
+        }
+        if(!deeper) return;
+        reported_iterations++;
+        emit iteration_finished(best->first, best->second);
+    }
+}
+
 void AIMultiThread::check_futures() {
     bool is_finished = true;
     int current_finished_futures = futures.size();
@@ -41,8 +86,10 @@ void AIMultiThread::check_futures() {
         num_finished_futures = current_finished_futures;
         emit think_updated(num_finished_futures / (float) futures.size());
     }
+    report_iterations();
 
     if(!is_finished) return;
+    future_checking_timer->stop();
 
     for(int i = 0; i < futures.size(); i++) {
         this->scores.push_back(futures[i].result());
@@ -57,7 +104,7 @@ std::optional<ChessBoard> AIMultiThread::get_best() {
     ChessBoard best_board = children[0];
     int best_score = scores[0];
     for(int i = 0; i < children.size(); i++) {
-        if(best_score > scores[i]) {
+        if(better(scores[i], best_score)) {
             best_board = children[i];
             best_score = scores[i];
         }
@@ -65,3 +112,12 @@ std::optional<ChessBoard> AIMultiThread::get_best() {
 
     return best_board;
 }
+
+int AIMultiThread::get_best_score() {
+    if(scores.empty()) return 0;
+    int best_score = scores[0];
+    for(int score : scores) {
+        if(better(score, best_score)) best_score = score;
+    }
+    return best_score;
+}
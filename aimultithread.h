@@ -2,6 +2,7 @@
 #define AIMULTITHREAD_H
 
 #include <vector>
+#include <QMutex>
 #include <QObject>
 #include <QtConcurrent>
 #include "chessboard.h"
@@ -11,19 +12,33 @@ class AIMultiThread : public QObject
     Q_OBJECT
 public:
     explicit AIMultiThread(QObject *parent = nullptr);
-    AIMultiThread(ChessBoard b, Team t);
+    //the child searches run on pool (the global one if null), pinned to cpus if any are given
+    AIMultiThread(ChessBoard b, Team t, TranspositionTable * table = nullptr, const std::vector<uint64_t> &history = {},
+                  QThreadPool * pool = nullptr, const std::vector<int> &cpus = {});
     ~AIMultiThread();
     std::optional<ChessBoard> get_best();
+    int get_best_score();
     void start();
 
 private:
     QTimer *future_checking_timer;
     Team team;
     ChessBoard board;
+    TranspositionTable * table;//shared by the child searches, may be null
+    std::vector<uint64_t> history;//game positions before the root, the root's key is appended in start()
+    QThreadPool * pool;
+    std::vector<int> cpus;
     std::vector<QFuture<int>> futures;
     int num_finished_futures;
     std::vector<int> scores;
     std::vector<ChessBoard> children;
+    //per child, the score of every iteration it has completed so far
+    QMutex iteration_mutex;
+    std::vector<std::vector<std::pair<int, int>>> iteration_scores;//depth, score
+    size_t reported_iterations;
+
+    bool better(int a, int b);
+    void report_iterations();
 
 private slots:
     void check_futures();
@@ -31,6 +46,7 @@ private slots:
 signals:
     void finished();
     void think_updated(float percent);
+    void iteration_finished(int depth, int score);//once every child completed the depth, score is the best child's
 };
 
 #endif // AIMULTITHREAD_H
@@ -0,0 +1,104 @@
+#include "allocationstats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+int64_t AllocationStats::total_count() const {
+    int64_t total = 0;
+    for(int64_t c : count) total += c;
+    return total;
+}
+
+int64_t AllocationStats::total_bytes() const {
+    int64_t total = 0;
+    for(int64_t b : bytes) total += b;
+    return total;
+}
+
+AllocationStats AllocationStats::operator-(const AllocationStats &start) const {
+    AllocationStats difference;
+    for(int i = 0; i < static_cast<int>(AllocSite::Count); i++) {
+        difference.count[i] = count[i] - start.count[i];
+        difference.bytes[i] = bytes[i] - start.bytes[i];
+    }
+    return difference;
+}
+
+#ifdef ALLOC_TRACKING
+
+namespace {
+
+//plain zero-initialized thread locals, operator new must not allocate to reach them
+thread_local int current_site = static_cast<int>(AllocSite::Other);
+thread_local AllocationStats thread_stats;
+std::atomic<int64_t> process_count(0);
+std::atomic<int64_t> process_bytes(0);
+
+const char * SITE_NAMES[static_cast<int>(AllocSite::Count)] = {
+    "other", "search", "move_generation", "ordering", "evaluation"
+};
+
+}
+
+void * operator new(std::size_t size) {
+    thread_stats.count[current_site]++;
+    thread_stats.bytes[current_site] += size;
+    process_count.fetch_add(1, std::memory_order_relaxed);
+    process_bytes.fetch_add(size, std::memory_order_relaxed);
+    if(void * p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept {
+    std::free(p);
+}
+
+AllocSiteScope::AllocSiteScope(AllocSite site) {
+    previous = current_site;
+    //below the search itself the outermost site keeps the allocations, e.g. evaluating children while ordering them
+    if(current_site <= static_cast<int>(AllocSite::Search)) current_site = static_cast<int>(site);
+}
+
+AllocSiteScope::~AllocSiteScope() {
+    current_site = previous;
+}
+
+AllocationStats thread_allocations() {
+    return thread_stats;
+}
+
+int64_t process_allocations() {
+    return process_count.load(std::memory_order_relaxed);
+}
+
+int64_t process_allocated_bytes() {
+    return process_bytes.load(std::memory_order_relaxed);
+}
+
+std::string allocation_report(const AllocationStats &stats, int64_t nodes) {
+    std::string report;
+    char line[160];
+    double per_node = 1.0 / std::max<int64_t>(nodes, 1);
+    std::snprintf(line, sizeof(line), "%-16s %12s %14s %12s %12s\n", "site", "allocs", "bytes", "allocs/node", "bytes/node");
+    report += line;
+    for(int site = 0; site < static_cast<int>(AllocSite::Count); site++) {
+        if(stats.count[site] == 0) continue;
+        std::snprintf(line, sizeof(line), "%-16s %12lld %14lld %12.2f %12.0f\n", SITE_NAMES[site],
+                      static_cast<long long>(stats.count[site]), static_cast<long long>(stats.bytes[site]),
+                      stats.count[site] * per_node, stats.bytes[site] * per_node);
+        report += line;
+    }
+    std::snprintf(line, sizeof(line), "%-16s %12lld %14lld %12.2f %12.0f\n", "total", static_cast<long long>(stats.total_count()),
+                  static_cast<long long>(stats.total_bytes()), stats.total_count() * per_node, stats.total_bytes() * per_node);
+    report += line;
+    return report;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef ALLOCATIONSTATS_H
+#define ALLOCATIONSTATS_H
+
+#include "chessboard.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+    Heap allocation accounting for the search, compiled in only with
+    ALLOC_TRACKING (see chessboard.h). The engine then replaces the global
+    operator new, counting every allocation against the calling thread and
+    the ALLOC_SITE it was made under, so a search can report how much it
+    allocated and from where. Sites nest inside Search, below it the
+    outermost one wins: evaluation and move generation done while ordering
+    count as ordering, a leaf evaluation as evaluation.
+*/
+
+enum class AllocSite {
+    Other,//outside any marked site
+    Search,
+    MoveGeneration,
+    Ordering,//making, evaluating and sorting the children
+    Evaluation,
+    Count
+};
+
+struct AllocationStats {
+    int64_t count[static_cast<int>(AllocSite::Count)] = {};
+    int64_t bytes[static_cast<int>(AllocSite::Count)] = {};
+    int64_t total_count() const;
+    int64_t total_bytes() const;
+    AllocationStats operator-(const AllocationStats &start) const;
+};
+
+#ifdef ALLOC_TRACKING
+
+class AllocSiteScope
+{
+public:
+    explicit AllocSiteScope(AllocSite site);
+    ~AllocSiteScope();
+private:
+    int previous;
+};
+
+#define ALLOC_SITE_NAME(line) alloc_site_##line
+#define ALLOC_SITE_AT(site, line) AllocSiteScope ALLOC_SITE_NAME(line)(site)
+#define ALLOC_SITE(site) ALLOC_SITE_AT(site, __LINE__)
+
+AllocationStats thread_allocations();//made by the calling thread so far
+int64_t process_allocations();
+int64_t process_allocated_bytes();
+std::string allocation_report(const AllocationStats &stats, int64_t nodes);//one line per site, with per node rates
+
+#else
+
+#define ALLOC_SITE(site)
+
+#endif
+
+#endif // ALLOCATIONSTATS_H
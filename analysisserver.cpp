@@ -0,0 +1,197 @@
+#include "analysisserver.h"
+#include "engineoptions.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <algorithm>
+
+static const char * START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static QJsonArray line_to_json(const std::vector<Move> &line) {
+    QJsonArray retval;
+    for(Move m : line) retval.append(QString::fromStdString(ChessBoard::move_to_string(m)));
+    return retval;
+}
+
+static void add_result(QJsonObject &message, const SearchResult &result, Team to_move) {
+    if(result.best_move) message["move"] = QString::fromStdString(ChessBoard::move_to_string(*result.best_move));
+    //centipawns from the side to move's point of view
+    auto side_score = [to_move](int score) {
+        int cp = ChessBoard::centipawns(score);
+        return to_move == Team::Alpha ? cp : -cp;
+    };
+    message["score"] = side_score(result.score);
+    if(!result.lines.empty()) message["pv"] = line_to_json(result.lines[0].line);
+    if(result.lines.size() > 1) {
+        QJsonArray lines;
+        for(const PrincipalVariation &pv : result.lines) {
+            lines.append(QJsonObject{{"move", QString::fromStdString(ChessBoard::move_to_string(pv.move))},
+                                     {"score", side_score(pv.score)}, {"pv", line_to_json(pv.line)}});
+        }
+        message["lines"] = lines;
+    }
+    message["depth"] = result.depth;
+    message["nodes"] = static_cast<qint64>(result.nodes);
+    message["time"] = static_cast<qint64>(result.time);
+    message["nps"] = static_cast<qint64>(result.time > 0 ? result.nodes * 1000 / result.time : 0);
+}
+
+AnalysisServer::AnalysisServer(int workers, int queue_limit, size_t hash_megabytes, const QString &hash_file,
+                               TranspositionTable::Mapping hash_mapping, QObject *parent)
+    : QObject{parent}
+    , table(hash_megabytes, hash_file, hash_mapping)
+{
+    this->queue_limit = queue_limit;
+    this->pending_jobs = 0;
+    pool.setMaxThreadCount(workers);
+    connect(&local_server, &QLocalServer::newConnection, this, &AnalysisServer::on_local_connection);
+    connect(&tcp_server, &QTcpServer::newConnection, this, &AnalysisServer::on_tcp_connection);
+}
+
+AnalysisServer::~AnalysisServer() {
+    for(const std::shared_ptr<std::atomic<bool>> &flag : cancel_flags) {
+        flag->store(true);
+    }
+    pool.waitForDone();
+}
+
+void AnalysisServer::set_worker_cpus(const std::vector<int> &cpus) {
+    worker_cpus = cpus;
+}
+
+bool AnalysisServer::listen_local(const QString &name) {
+    QLocalServer::removeServer(name);
+    return local_server.listen(name);
+}
+
+bool AnalysisServer::listen_tcp(quint16 port) {
+    return tcp_server.listen(QHostAddress::LocalHost, port);
+}
+
+QString AnalysisServer::error_string() const {
+    if(!local_server.errorString().isEmpty()) return local_server.errorString();
+    return tcp_server.errorString();
+}
+
+void AnalysisServer::on_local_connection() {
+    while(QLocalSocket *socket = local_server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]{
+            remove_connection(socket);
+        });
+        add_connection(socket);
+    }
+}
+
+void AnalysisServer::on_tcp_connection() {
+    while(QTcpSocket *socket = tcp_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]{
+            remove_connection(socket);
+        });
+        add_connection(socket);
+    }
+}
+
+void AnalysisServer::add_connection(QIODevice *socket) {
+    cancel_flags.insert(socket, std::make_shared<std::atomic<bool>>(false));
+    connect(socket, &QIODevice::readyRead, this, [this, socket]{
+        while(socket->canReadLine()) {
+            handle_line(socket, socket->readLine().trimmed());
+        }
+    });
+}
+
+void AnalysisServer::remove_connection(QIODevice *socket) {
+    std::shared_ptr<std::atomic<bool>> flag = cancel_flags.take(socket);
+    if(flag) flag->store(true);
+    socket->deleteLater();
+}
+
+void AnalysisServer::handle_line(QIODevice *socket, const QByteArray &line) {
+    if(line.isEmpty()) return;
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(line, &error);
+    if(error.error != QJsonParseError::NoError) {
+        send(socket, QJsonObject{{"type", "error"}, {"message", error.errorString()}});
+        return;
+    }
+    if(document.isArray()) {
+        //a batch, every element is queued as its own request
+        const QJsonArray requests = document.array();
+        for(const QJsonValue &request : requests) {
+            handle_request(socket, request.toObject());
+        }
+    }
+    else {
+        handle_request(socket, document.object());
+    }
+}
+
+void AnalysisServer::handle_request(QIODevice *socket, const QJsonObject &request) {
+    QJsonObject reply{{"id", request.value("id")}};
+    auto fail = [&](const QString &message){
+        reply["type"] = "error";
+        reply["message"] = message;
+        send(socket, reply);
+    };
+
+    Team to_move = Team::Alpha;
+    std::optional<ChessBoard> board = ChessBoard::from_fen(request.value("fen").toString(START_FEN).toStdString(), &to_move);
+    if(!board) return fail("invalid fen");
+    const QJsonArray moves = request.value("moves").toArray();
+    std::vector<uint64_t> history;//so the search sees repetitions of the game's positions
+    for(const QJsonValue &text : moves) {
+        std::optional<Move> move = board->parse_move(text.toString().toStdString(), to_move);
+        if(!move) return fail(QString("illegal move %1").arg(text.toString()));
+        history.push_back(board->key(to_move));
+        board->do_move(*move);
+        to_move = team_inverse(to_move);
+    }
+
+    SearchLimits limits;
+    limits.depth = request.value("depth").toInt(0);
+    limits.nodes = request.value("nodes").toVariant().toLongLong();
+    limits.movetime = request.value("movetime").toVariant().toLongLong();
+    limits.multipv = std::max(1, request.value("multipv").toInt(1));
+    //the mover's clock, white being Alpha
+    bool white = to_move == Team::Alpha;
+    limits.time_left = request.value(white ? "wtime" : "btime").toVariant().toLongLong();
+    limits.increment = request.value(white ? "winc" : "binc").toVariant().toLongLong();
+    limits.moves_to_go = request.value("movestogo").toInt(0);
+
+    if(pending_jobs.load() >= pool.maxThreadCount() + queue_limit) {
+        reply["type"] = "busy";
+        send(socket, reply);
+        return;
+    }
+    pending_jobs++;
+
+    QPointer<QIODevice> target(socket);
+    std::shared_ptr<std::atomic<bool>> cancel = cancel_flags.value(socket);
+    ChessBoard position = *board;
+    pool.start([this, target, cancel, position, to_move, limits, reply, history]() mutable {
+        pin_engine_thread(worker_cpus);
+        table.new_search();
+        SearchResult result = position.search(to_move, limits, &table, cancel.get(), [&](const SearchResult &iteration){
+            QJsonObject info = reply;
+            info["type"] = "info";
+            add_result(info, iteration, to_move);
+            send(target, info);
+        }, history);
+        QJsonObject done = reply;
+        done["type"] = "bestmove";
+        add_result(done, result, to_move);
+        send(target, done);
+        pending_jobs--;
+    });
+}
+
+//safe from worker threads, the write itself happens on the server's thread
+void AnalysisServer::send(QPointer<QIODevice> socket, const QJsonObject &message) {
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n';
+    QMetaObject::invokeMethod(this, [socket, line]{
+        if(socket) socket->write(line);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,70 @@
+#ifndef ANALYSISSERVER_H
+#define ANALYSISSERVER_H
+
+#include "chessboard.h"
+#include "transpositiontable.h"
+
+#include <QObject>
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QPointer>
+#include <QTcpServer>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+/*
+    Long running analysis service. Clients connect over a local socket or
+    TCP and send one JSON request per line (or a JSON array of requests as
+    a batch):
+
+        {"id": 1, "fen": "<fen>", "moves": ["e2e4"], "depth": 8, "nodes": 0, "movetime": 0}
+
+    or with a game clock instead of fixed limits, in milliseconds:
+
+        {"id": 2, "fen": "<fen>", "wtime": 60000, "btime": 60000, "winc": 1000, "binc": 1000, "movestogo": 0}
+
+    Requests are queued onto a bounded worker pool sharing one
+    transposition table. Each completed iteration is streamed back as an
+    "info" line and the search ends with a "bestmove" line. Requests over
+    the queue limit are answered with "busy" instead of being queued.
+*/
+
+class AnalysisServer : public QObject
+{
+    Q_OBJECT
+public:
+    //hash_file, if not empty, keeps the table in that file across restarts
+    AnalysisServer(int workers, int queue_limit, size_t hash_megabytes, const QString &hash_file = QString(),
+                   TranspositionTable::Mapping hash_mapping = TranspositionTable::Mapping::Shared, QObject *parent = nullptr);
+    ~AnalysisServer();
+    bool listen_local(const QString &name);
+    bool listen_tcp(quint16 port);
+    QString error_string() const;
+    const TranspositionTable &transposition_table() const {return table;}
+    void set_worker_cpus(const std::vector<int> &cpus);//pins each worker to one of cpus
+
+private:
+    QLocalServer local_server;
+    QTcpServer tcp_server;
+    QThreadPool pool;
+    TranspositionTable table;
+    int queue_limit;
+    std::vector<int> worker_cpus;
+    std::atomic<int> pending_jobs;
+    //set when a client goes away so its searches stop early
+    QHash<QIODevice *, std::shared_ptr<std::atomic<bool>>> cancel_flags;
+
+    void add_connection(QIODevice *socket);
+    void remove_connection(QIODevice *socket);
+    void handle_line(QIODevice *socket, const QByteArray &line);
+    void handle_request(QIODevice *socket, const QJsonObject &request);
+    void send(QPointer<QIODevice> socket, const QJsonObject &message);
+
+private slots:
+    void on_local_connection();
+    void on_tcp_connection();
+};
+
+#endif // ANALYSISSERVER_H
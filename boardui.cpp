@@ -5,6 +5,8 @@
 
 BoardUI::BoardUI(QWidget * parent) : QFrame(parent)
 {
+    engine_table = std::make_unique<TranspositionTable>(engine_options.hash_megabytes);
+    think_pool.setMaxThreadCount(engine_options.thread_count());
     held_piece = std::nullopt;
     sprite_sheet = new QSvgRenderer(QString("boardsprites.svg"), this);
     if(!sprite_sheet->isValid()) {
@@ -12,6 +14,14 @@ BoardUI::BoardUI(QWidget * parent) : QFrame(parent)
         exit(20);
     }
     currentTurn = Team::Alpha;
+    atlas_sprite_pixels = 0;
+    atlas_pixel_ratio = 0;
+    legal_moves_ready = false;
+    connect(&legal_moves_watcher, &QFutureWatcher<LegalMoves>::finished, this, &BoardUI::on_legal_moves_ready);
+    refresh_legal_moves();
+    thinking = false;
+    connect(&evaluation_watcher, &QFutureWatcher<int>::finished, this, &BoardUI::on_evaluation_ready);
+    evaluate_in_background();
 }
 BoardUI::~BoardUI() {
     delete sprite_sheet;
@@ -22,51 +32,96 @@ void BoardUI::paintEvent(QPaintEvent *e) {
     float cell_size = board_size/8.0;
     float top_edge = (this->height()-board_size)/2.0;
     float left_edge = (this->width()-board_size)/2.0;
-    float bottom_edge = top_edge+board_size;
-    float right_edge = left_edge+board_size;
 
+    if(background.isNull() || background.devicePixelRatio() != devicePixelRatioF()) rebuild_background();
 
     QPainter p(this);
+    p.drawPixmap(0, 0, background);
 
-    p.setPen(QColor(0,0,0));
+    if(held_piece && legal_moves_ready) {//destination hints
+        p.setPen(Qt::NoPen);
+        p.setBrush(QColor(40, 120, 200, 110));
+        for(QPoint dest : legal_destinations[held_piece_origin.x() + held_piece_origin.y()*8]) {
+            QRectF cell = cell_rect(dest);
+            p.drawEllipse(cell.center(), cell.width()*0.15, cell.height()*0.15);
+        }
+    }
 
+    float sprite_padding = SPRITE_MARGIN*cell_size;
+    const float sprite_size = cell_size - 2*sprite_padding;
 
     for(int x = 0; x < 8; x++) {
         for(int y = 0; y < 8; y++) {
-            if((x+y) % 2) {
-                p.fillRect(QRectF(left_edge + x*cell_size, top_edge + y*cell_size, cell_size, cell_size), QColor(100,100,100));
-            } else continue;
+            if(!board.at(QPoint(x,y))) continue;
+            QRectF location(left_edge + x*cell_size + sprite_padding, top_edge + y*cell_size + sprite_padding, sprite_size, sprite_size);
+            if(!e->rect().intersects(location.toAlignedRect())) continue;//outside the dirty region
+            draw_sprite(&p, location, *board.at(QPoint(x,y)));
         }
     }
 
-    for(int i = 0; i <= 8; i++) {
-        p.drawLine(QPointF(left_edge, top_edge + i*cell_size),QPointF(right_edge, top_edge + i*cell_size));//horizontal lines
-        p.drawLine(QPointF(left_edge + i*cell_size,top_edge),QPointF(left_edge + i*cell_size, bottom_edge));//vertical lines
+    if(held_piece){
+        draw_sprite(&p, held_piece_rect(mouse_pos), *held_piece);
     }
+}
 
+void BoardUI::resizeEvent(QResizeEvent * e) {
+    QFrame::resizeEvent(e);
+    background = QPixmap();
+}
 
-    //TODO: add checkerboard
+//squares and grid lines, which only change with the widget size
+void BoardUI::rebuild_background() {
+    float board_size = std::min(this->width(),this->height())*(1.0-MARGIN);
+    float cell_size = board_size/8.0;
+    float top_edge = (this->height()-board_size)/2.0;
+    float left_edge = (this->width()-board_size)/2.0;
+    float bottom_edge = top_edge+board_size;
+    float right_edge = left_edge+board_size;
 
-    const float sprite_margin = 0.1;
-    float sprite_padding = sprite_margin*cell_size;
-    const float sprite_size = cell_size - 2*sprite_padding;
+    background = QPixmap(this->size() * devicePixelRatioF());
+    background.setDevicePixelRatio(devicePixelRatioF());
+    background.fill(Qt::transparent);
+    QPainter p(&background);
+
+    p.setPen(QColor(0,0,0));
 
     for(int x = 0; x < 8; x++) {
         for(int y = 0; y < 8; y++) {
-            if(!board.at(QPoint(x,y))) continue;
-            draw_sprite(&p, QRectF(left_edge + x*cell_size + sprite_padding, top_edge + y*cell_size + sprite_padding, sprite_size, sprite_size), *board.at(QPoint(x,y)));
+            if((x+y) % 2) {
+                p.fillRect(QRectF(left_edge + x*cell_size, top_edge + y*cell_size, cell_size, cell_size), QColor(100,100,100));
+            } else continue;
         }
     }
 
-    if(held_piece){
-        draw_sprite(&p, QRectF(mouse_pos.x() - sprite_size/2.0, mouse_pos.y() - sprite_size/2.0, sprite_size, sprite_size), *held_piece);
+    for(int i = 0; i <= 8; i++) {
+        p.drawLine(QPointF(left_edge, top_edge + i*cell_size),QPointF(right_edge, top_edge + i*cell_size));//horizontal lines
+        p.drawLine(QPointF(left_edge + i*cell_size,top_edge),QPointF(left_edge + i*cell_size, bottom_edge));//vertical lines
     }
 }
+
+QRectF BoardUI::cell_rect(QPoint index) {
+    float board_size = std::min(this->width(),this->height())*(1.0-MARGIN);
+    float cell_size = board_size/8.0;
+    float top_edge = (this->height()-board_size)/2.0;
+    float left_edge = (this->width()-board_size)/2.0;
+    return QRectF(left_edge + index.x()*cell_size, top_edge + index.y()*cell_size, cell_size, cell_size);
+}
+
+//where the held piece is drawn with the cursor at pos
+QRectF BoardUI::held_piece_rect(QPoint pos) {
+    float board_size = std::min(this->width(),this->height())*(1.0-MARGIN);
+    float sprite_size = board_size/8.0*(1.0 - 2*SPRITE_MARGIN);
+    return QRectF(pos.x() - sprite_size/2.0, pos.y() - sprite_size/2.0, sprite_size, sprite_size);
+}
+
 void BoardUI::mouseMoveEvent(QMouseEvent * e){
     if(!held_piece) return;
     e->accept();
+    //repaint only where the held piece was and where it is now
+    QRect dirty = held_piece_rect(mouse_pos).toAlignedRect();
     mouse_pos = e->pos();
-    this->update();
+    dirty = dirty.united(held_piece_rect(mouse_pos).toAlignedRect());
+    this->update(dirty.adjusted(-1, -1, 1, 1));
 }
 void BoardUI::mousePressEvent(QMouseEvent * e){
     if(held_piece) return;
@@ -75,51 +130,98 @@ void BoardUI::mousePressEvent(QMouseEvent * e){
     e->accept();
     held_piece_origin = *index;
     held_piece = board.at(*index);
-    board.at(*index) = std::nullopt;
+    board.place(*index, std::nullopt);
+    mouse_pos = e->pos();
+    QRect dirty = cell_rect(*index).toAlignedRect().united(held_piece_rect(mouse_pos).toAlignedRect());
+    if(legal_moves_ready) {
+        for(QPoint dest : legal_destinations[index->x() + index->y()*8]) dirty = dirty.united(cell_rect(dest).toAlignedRect());
+    }
+    this->update(dirty.adjusted(-1, -1, 1, 1));
 }
 void BoardUI::mouseReleaseEvent(QMouseEvent * e){
     if(!held_piece) return;
     std::optional<QPoint> dest = mouseToBoard(e->pos());
     e->accept();
-    ChessBoard proposed_board = this->board;
-    proposed_board.at(held_piece_origin) = held_piece;
-    if(!dest || !proposed_board.legal_move(Move{held_piece.value(), held_piece_origin, dest.value()})) {//if mouse out of bounds or invalid placement
+    ChessBoard position = this->board;
+    position.place(held_piece_origin, held_piece);
+    uint64_t position_key = position.key(Team::Alpha);
+    if(!dest || !legal_drop(*dest)) {//if mouse out of bounds or invalid placement
         if(held_piece.value().rank == Rank::King && held_piece_origin == QPoint(4,7)){
             //TODO: proper checks
             if(dest.value() == QPoint(6,7)) {
-                board.at(*dest) = held_piece;
-                board.at(5,7) = Piece(Team::Alpha, Rank::Rook);
-                board.at(7,7) = std::nullopt;
+                board.place(*dest, held_piece);
+                board.place(QPoint(5,7), Piece(Team::Alpha, Rank::Rook));
+                board.place(QPoint(7,7), std::nullopt);
 
-                emit evaluation_updated(board.heuristic(team_inverse(held_piece.value().team)));
                 held_piece = std::nullopt;
+                legal_moves_ready = false;
+                game_history.push_back(position_key);
                 emit move_made(Team::Alpha);
                 this->doAIMove(Team::Beta);
             }
             if(dest.value() == QPoint(2, 7)) {
-                board.at(*dest) = held_piece;
-                board.at(3,7) = Piece(Team::Alpha, Rank::Rook);
-                board.at(0,7) = std::nullopt;
+                board.place(*dest, held_piece);
+                board.place(QPoint(3,7), Piece(Team::Alpha, Rank::Rook));
+                board.place(QPoint(0,7), std::nullopt);
 
-                emit evaluation_updated(board.heuristic(team_inverse(held_piece.value().team)));
                 held_piece = std::nullopt;
+                legal_moves_ready = false;
+                game_history.push_back(position_key);
                 emit move_made(Team::Alpha);
                 this->doAIMove(Team::Beta);
             }
         } else {
-            board.at(held_piece_origin) = held_piece;
+            board.place(held_piece_origin, held_piece);
             held_piece = std::nullopt;
         }
     }
     else {
-        board.at(*dest) = held_piece;
-        emit evaluation_updated(board.heuristic(team_inverse(held_piece.value().team)));
+        //through do_move so castling rights and the halfmove clock stay right
+        board.place(held_piece_origin, held_piece);
+        board.do_move(Move{held_piece.value(), held_piece_origin, dest.value()});
         held_piece = std::nullopt;
+        legal_moves_ready = false;
+        game_history.push_back(position_key);
         emit move_made(Team::Alpha);
         this->doAIMove(Team::Beta);
     }
     this->update();
 }
+//checks a drop of the held piece against the per-turn cache, or generates the moves if it is not ready yet
+bool BoardUI::legal_drop(QPoint dest) {
+    if(legal_moves_ready) {
+        const std::vector<QPoint> &destinations = legal_destinations[held_piece_origin.x() + held_piece_origin.y()*8];
+        return std::find(destinations.begin(), destinations.end(), dest) != destinations.end();
+    }
+    ChessBoard proposed_board = this->board;
+    proposed_board.place(held_piece_origin, held_piece);
+    return proposed_board.legal_move(Move{held_piece.value(), held_piece_origin, dest});
+}
+
+//generates the side to move's legal moves on the global pool once per turn
+void BoardUI::refresh_legal_moves() {
+    legal_moves_ready = false;
+    ChessBoard position = this->board;
+    Team team = currentTurn;
+    legal_moves_watcher.setFuture(QtConcurrent::run([position, team]() {
+        ChessBoard copy = position;
+        return LegalMoves(copy.key(team), copy.gen_filtered_children_moves(team));
+    }));
+}
+
+void BoardUI::on_legal_moves_ready() {
+    LegalMoves result = legal_moves_watcher.result();
+    ChessBoard current = this->board;
+    if(held_piece) current.place(held_piece_origin, held_piece);
+    if(result.first != current.key(currentTurn)) return;//the board changed while generating
+    for(std::vector<QPoint> &destinations : legal_destinations) destinations.clear();
+    for(Move m : result.second) {
+        legal_destinations[m.origin.x() + m.origin.y()*8].push_back(m.destination);
+    }
+    legal_moves_ready = true;
+    if(held_piece) this->update();
+}
+
 std::optional<QPoint> BoardUI::mouseToBoard(QPoint p) {
     float board_size = std::min(this->width(),this->height())*(1.0-MARGIN);
     float cell_size = board_size/8.0;
@@ -132,50 +234,81 @@ std::optional<QPoint> BoardUI::mouseToBoard(QPoint p) {
     return p;
 }
 
-void BoardUI::draw_sprite(QPainter *painter, QRectF location, Piece piece) {
+//column and row of a piece in boardsprites.svg along with its element id
+static QPoint sprite_cell(Piece piece, QString * element) {
     int draw_y = 0;
-    QString element;
     if(piece.team == Team::Beta) {
-        draw_y = sprite_size.y();
-        element += QString("black");
+        draw_y = 1;
+        *element = QString("black");
     }
-    else element += QString("white");
+    else *element = QString("white");
     int draw_x = 0;
     switch(piece.rank) {
     case Rank::Pawn:
         draw_x = 5;
-        element += QString("pawn");
+        *element += QString("pawn");
         break;
     case Rank::Rook:
         draw_x = 4;
-        element += QString("rook");
+        *element += QString("rook");
         break;
     case Rank::Knight:
         draw_x = 3;
-        element += QString("knight");
+        *element += QString("knight");
         break;
     case Rank::Bishop:
         draw_x = 2;
-        element += QString("bishop");
+        *element += QString("bishop");
         break;
     case Rank::Queen:
         draw_x = 1;
-        element += QString("queen");
+        *element += QString("queen");
         break;
     case Rank::King:
         draw_x = 0;
-        element += QString("king");
+        *element += QString("king");
         break;
     }
-    draw_x *= sprite_size.x();
-    sprite_sheet->setViewBox(QRectF(draw_x, draw_y, sprite_size.x(), sprite_size.y()));
-    sprite_sheet->render(painter, element, location);
+    return QPoint(draw_x, draw_y);
+}
+
+//rasterizes all twelve sprites once, laid out like the sheet, so painting is a blit
+void BoardUI::rebuild_sprite_atlas(int sprite_pixels, qreal pixel_ratio) {
+    sprite_atlas = QPixmap(6*sprite_pixels, 2*sprite_pixels);
+    sprite_atlas.fill(Qt::transparent);
+    QPainter atlas_painter(&sprite_atlas);
+    for(Team team : {Team::Alpha, Team::Beta}) {
+        for(Rank rank : {Rank::Pawn, Rank::Knight, Rank::Bishop, Rank::Rook, Rank::Queen, Rank::King}) {
+            QString element;
+            QPoint cell = sprite_cell(Piece(team, rank), &element);
+            sprite_sheet->setViewBox(QRectF(cell.x()*sprite_size.x(), cell.y()*sprite_size.y(), sprite_size.x(), sprite_size.y()));
+            sprite_sheet->render(&atlas_painter, element, QRectF(cell.x()*sprite_pixels, cell.y()*sprite_pixels, sprite_pixels, sprite_pixels));
+        }
+    }
+    atlas_painter.end();
+    sprite_atlas.setDevicePixelRatio(pixel_ratio);
+    atlas_sprite_pixels = sprite_pixels;
+    atlas_pixel_ratio = pixel_ratio;
+}
+
+void BoardUI::draw_sprite(QPainter *painter, QRectF location, Piece piece) {
+    int sprite_pixels = qRound(location.width() * devicePixelRatioF());
+    if(sprite_pixels <= 0) return;
+    if(sprite_pixels != atlas_sprite_pixels || devicePixelRatioF() != atlas_pixel_ratio) {
+        rebuild_sprite_atlas(sprite_pixels, devicePixelRatioF());
+    }
+    QString element;
+    QPoint cell = sprite_cell(piece, &element);
+    painter->drawPixmap(location, sprite_atlas, QRectF(cell.x()*sprite_pixels, cell.y()*sprite_pixels, sprite_pixels, sprite_pixels));
 }
 
 void BoardUI::doAIMove(Team t) {
-    this->ai_threads = new AIMultiThread(board, t);
+    thinking = true;
+    engine_table->new_search();
+    this->ai_threads = new AIMultiThread(board, t, engine_table.get(), game_history, &think_pool, engine_options.cpus);
     connect(ai_threads, &AIMultiThread::finished, this, &BoardUI::on_think_finished);
     connect(ai_threads, &AIMultiThread::think_updated, this, &BoardUI::on_think_updated);
+    connect(ai_threads, &AIMultiThread::iteration_finished, this, &BoardUI::on_iteration_finished);
     ai_threads->start();
 }
 
@@ -216,11 +349,15 @@ void BoardUI::on_move_made(Team t) {
 void BoardUI::on_think_finished() {
     std::optional<ChessBoard> retval = ai_threads->get_best();
     if(retval.has_value()) {
+        game_history.push_back(board.key(Team::Beta));
         this->board = retval.value();
+        int score = ai_threads->get_best_score();
         delete ai_threads;
+        thinking = false;
         emit move_made(Team::Beta);
-        emit evaluation_updated(board.heuristic(Team::Alpha));
+        emit evaluation_updated(ChessBoard::centipawns(score));//the score the move was chosen by
         emit think_finished();
+        refresh_legal_moves();
         this->update();
     }
     else {
@@ -232,8 +369,48 @@ void BoardUI::on_think_updated(float percent) {
     emit think_updated(percent);
 }
 
+void BoardUI::on_iteration_finished(int depth, int score) {
+    Q_UNUSED(depth);
+    emit evaluation_updated(ChessBoard::centipawns(score));
+}
+
+//shallow search for the evaluation bar while the engine is not thinking
+void BoardUI::evaluate_in_background() {
+    ChessBoard position = this->board;
+    Team team = currentTurn;
+    std::vector<int> cpus = engine_options.cpus;
+    evaluation_watcher.setFuture(QtConcurrent::run(&think_pool, [position, team, cpus]() {
+        pin_engine_thread(cpus);
+        ChessBoard copy = position;
+        SearchLimits limits;
+        limits.depth = FALLBACK_EVALUATION_DEPTH;
+        return ChessBoard::centipawns(copy.search(team, limits).score);
+    }));
+}
+
+void BoardUI::on_evaluation_ready() {
+    if(thinking) return;//the search's own scores are more accurate
+    emit evaluation_updated(evaluation_watcher.result());
+}
+
+void BoardUI::set_engine_options(const EngineOptions &options) {
+    if(thinking) return;
+    think_pool.setMaxThreadCount(options.thread_count());
+    if(options.hash_megabytes != engine_options.hash_megabytes || options.hash_file != engine_options.hash_file) {
+        engine_table = std::make_unique<TranspositionTable>(options.hash_megabytes, options.hash_file);
+        if(!options.hash_file.isEmpty() && !engine_table->is_mapped()) {
+            QMessageBox::warning(this, QString("Engine hash"), QString("Could not use %1, the engine's table is kept in memory instead.\n%2")
+                                 .arg(options.hash_file, engine_table->error_string()));
+        }
+    }
+    engine_options = options;
+}
+
 void BoardUI::reset_board() {
     this->board = ChessBoard();
-    emit evaluation_updated(board.heuristic(Team::Alpha));
+    game_history.clear();
+    if(!engine_table->is_mapped()) engine_table->clear();//a file backed table is meant to outlive games
+    refresh_legal_moves();
+    evaluate_in_background();
     this->update();
 }
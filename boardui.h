@@ -3,11 +3,16 @@
 
 #include "chessboard.h"
 #include "aimultithread.h"
+#include "transpositiontable.h"
+#include "engineoptions.h"
 
 #include <QFrame>
 #include <QWidget>
 #include <QPaintEvent>
 #include <QMouseEvent>
+#include <QResizeEvent>
+#include <QPixmap>
+#include <QFutureWatcher>
 #include <optional>
 #include <QtSvg/QtSvg>
 #include <QtConcurrent/QtConcurrent>
@@ -24,31 +29,60 @@ public:
     void mouseMoveEvent(QMouseEvent * e);
     void mousePressEvent(QMouseEvent * e);
     void mouseReleaseEvent(QMouseEvent * e);
+    void resizeEvent(QResizeEvent * e);
     void doAIMove(Team t);
     void reset_board();
+    void set_engine_options(const EngineOptions &options);//while the engine is not thinking
     const float MARGIN = 0.1;
+    const float SPRITE_MARGIN = 0.1;//of a cell, on each side
 private:
     AIMultiThread * ai_threads;
     Team currentTurn;
     std::optional<QPoint> mouseToBoard(QPoint p);
     void draw_sprite(QPainter * painter, QRectF location, Piece piece);
+    void rebuild_sprite_atlas(int sprite_pixels, qreal pixel_ratio);
+    void rebuild_background();
+    QRectF cell_rect(QPoint index);
+    QRectF held_piece_rect(QPoint pos);
+    bool legal_drop(QPoint dest);
+    void refresh_legal_moves();
     QPoint mouse_pos;
     QPoint held_piece_origin;
     std::optional<Piece> held_piece;
     ChessBoard board;
     QSvgRenderer * sprite_sheet;
     const QPoint sprite_size = QPoint(45,45);
+    QPixmap sprite_atlas;//rasterized sprites for the current cell size and device pixel ratio
+    int atlas_sprite_pixels;
+    qreal atlas_pixel_ratio;
+    QPixmap background;//squares and grid, cleared on resize
+    typedef std::pair<uint64_t, std::vector<Move>> LegalMoves;//position key and its moves
+    QFutureWatcher<LegalMoves> legal_moves_watcher;
+    std::vector<QPoint> legal_destinations[64];//by origin x + y*8, for the side to move
+    bool legal_moves_ready;
+    EngineOptions engine_options;
+    std::unique_ptr<TranspositionTable> engine_table;//kept across the engine's moves in one game
+    static const int FALLBACK_EVALUATION_DEPTH = 2;
+    bool thinking;
+    std::vector<uint64_t> game_history;//key of the position before each move, for repetition detection
+    QFutureWatcher<int> evaluation_watcher;
+    void evaluate_in_background();
     QThreadPool think_pool;
 signals:
     void move_made(Team t);
     void think_updated(float percent);
     void think_finished();
-    void evaluation_updated(int value);
+    void evaluation_updated(int centipawns);//Alpha positive
 
 public slots:
     void on_move_made(Team t);
     void on_think_updated(float percent);
     void on_think_finished();
+    void on_iteration_finished(int depth, int score);
+
+private slots:
+    void on_legal_moves_ready();
+    void on_evaluation_ready();
 };
 
 #endif // BOARDUI_H
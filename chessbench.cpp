@@ -0,0 +1,247 @@
+#include "chessboard.h"
+#include "allocationstats.h"
+#include "evalkernels.h"
+#include "transpositiontable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+static const int BENCH_DEPTH = 6;
+
+static volatile int sink;
+#ifdef ALLOC_TRACKING
+//the engine replaces operator new itself and counts per search, see allocationstats.h
+static int64_t allocation_count() {
+    return process_allocations();
+}
+
+static int64_t allocation_bytes() {
+    return process_allocated_bytes();
+}
+#else
+static std::atomic<int64_t> allocations(0);
+static std::atomic<int64_t> allocated_bytes(0);
+
+//every heap allocation in the process goes through here so benchmarks can report them
+void * operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if(void * p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static int64_t allocation_count() {
+    return allocations.load();
+}
+
+static int64_t allocation_bytes() {
+    return allocated_bytes.load();
+}
+#endif
+
+struct Measurement {
+    double ns;//per op
+    double allocations;
+    double bytes;
+};
+
+//reproducible middlegame-ish positions from seeded playouts of the opening
+static std::vector<std::pair<ChessBoard, Team>> bench_positions() {
+    std::vector<std::pair<ChessBoard, Team>> positions;
+    uint32_t seed = 1;
+    for(int game = 0; game < 8; game++) {
+        ChessBoard board;
+        Team team = Team::Alpha;
+        for(int ply = 0; ply < 12 + game*4; ply++) {
+            std::vector<Move> moves = board.gen_filtered_children_moves(team);
+            if(moves.empty()) break;
+            seed = seed * 1664525u + 1013904223u;
+            board.do_move(moves[(seed >> 16) % moves.size()]);
+            team = team_inverse(team);
+        }
+        positions.push_back({board, team});
+    }
+    return positions;
+}
+
+template<typename F>
+static Measurement measure(int iterations, F f) {
+    for(int i = 0; i < iterations / 10; i++) f(i);//warm up caches and the branch predictor
+    int64_t start_allocations = allocation_count();
+    int64_t start_bytes = allocation_bytes();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) f(i);
+    auto end = std::chrono::steady_clock::now();
+    return Measurement{
+        std::chrono::duration<double, std::nano>(end - start).count() / iterations,
+        static_cast<double>(allocation_count() - start_allocations) / iterations,
+        static_cast<double>(allocation_bytes() - start_bytes) / iterations
+    };
+}
+
+static void print_header() {
+    printf("%-30s %-8s %12s %10s %10s\n", "benchmark", "isa", "ns/op", "allocs/op", "bytes/op");
+}
+
+static void print_measurement(const char * name, const char * isa, const Measurement &m) {
+    printf("%-30s %-8s %12.1f %10.2f %10.0f\n", name, isa, m.ns, m.allocations, m.bytes);
+}
+
+static bool selected(const char * name, const char * filter) {
+    return !filter || std::strstr(name, filter);
+}
+
+static void bench_eval_kernels(std::vector<std::pair<ChessBoard, Team>> &positions, const char * filter) {
+    const int iterations = 200000;
+    alignas(32) int32_t values[64];
+    alignas(32) int32_t ad_map[64];
+    for(int i = 0; i < 64; i++) {
+        values[i] = (i * 7) % 19 - 9;
+        ad_map[i] = (i * 5) % 7 - 3;
+    }
+
+    EvalIsa native = eval_isa();
+    for(EvalIsa isa : {EvalIsa::Scalar, EvalIsa::SSSE3, EvalIsa::AVX2}) {
+        if(!eval_isa_supported(isa)) continue;
+        eval_set_isa(isa);
+        if(selected("material_sum", filter)) {
+            print_measurement("material_sum", eval_isa_name(isa), measure(iterations, [&](int i) {
+                values[i & 63] ^= 1;
+                sink = eval_material_sum(values);
+            }));
+        }
+        if(selected("attack_defend_sum", filter)) {
+            print_measurement("attack_defend_sum", eval_isa_name(isa), measure(iterations, [&](int i) {
+                ad_map[i & 63] = -ad_map[i & 63];
+                sink = eval_attack_defend_sum(values, ad_map);
+            }));
+        }
+        if(selected("heuristic", filter)) {
+            print_measurement("heuristic", eval_isa_name(isa), measure(iterations / 20, [&](int i) {
+                std::pair<ChessBoard, Team> &position = positions[i % positions.size()];
+                sink = position.first.heuristic(position.second);
+            }));
+        }
+    }
+    eval_set_isa(native);
+}
+
+static void bench_board(std::vector<std::pair<ChessBoard, Team>> &positions, const char * filter) {
+    const char * isa = eval_isa_name(eval_isa());
+    if(selected("gen_all_children_moves", filter)) {
+        print_measurement("gen_all_children_moves", isa, measure(100000, [&](int i) {
+            std::pair<ChessBoard, Team> &position = positions[i % positions.size()];
+            sink = position.first.gen_all_children_moves(position.second).size();
+        }));
+    }
+    if(selected("gen_filtered_children_boards", filter)) {
+        print_measurement("gen_filtered_children_boards", isa, measure(20000, [&](int i) {
+            std::pair<ChessBoard, Team> &position = positions[i % positions.size()];
+            sink = position.first.gen_filtered_children_boards(position.second).size();
+        }));
+    }
+    if(selected("get_check", filter)) {
+        print_measurement("get_check", isa, measure(200000, [&](int i) {
+            std::pair<ChessBoard, Team> &position = positions[i % positions.size()];
+            sink = position.first.get_check(position.second);
+        }));
+    }
+    if(selected("search", filter)) {
+        //search() to depth 4, iterating at depths 2 and 4, without a transposition table so every run visits the same tree
+        const int depth = 4;
+        int64_t nodes = 0;
+        int searches = static_cast<int>(positions.size()) * 2;
+        Measurement m = measure(searches, [&](int i) {
+            std::pair<ChessBoard, Team> &position = positions[i % positions.size()];
+            SearchLimits limits;
+            limits.depth = depth;
+            nodes += position.first.search(position.second, limits).nodes;
+        });
+        print_measurement("search depth 4", isa, m);
+        //nodes also counts the warm-up searches
+        double nodes_per_search = static_cast<double>(nodes) / (searches + searches / 10);
+        printf("%-30s %-8s %12.0f nodes/s, %.1f allocs/node\n", "search depth 4", isa,
+               nodes_per_search / (m.ns / 1e9), m.allocations / nodes_per_search);
+    }
+}
+
+//fixed workload for `chess_bench bench`, keep the list stable so signatures stay comparable
+static const char * BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r1bqk2r/pppp1ppp/2n2n2/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 5",
+    "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+    "rnbqkb1r/ppp2ppp/4pn2/3p4/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 2 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2Q1RK1 b - - 3 10",
+    "r1b2rk1/2q1bppp/p2ppn2/1p6/3BPP2/2N2B2/PPP3PP/R2Q1R1K w - - 0 14",
+    "2r2rk1/pp3ppp/2n1bq2/3p4/3P4/2PB1N2/P4PPP/R2Q1RK1 w - - 4 17",
+    "4r1k1/1p3ppp/p1p5/3pq3/3Q4/1P4P1/P4P1P/4R1K1 b - - 1 24",
+    "8/5pk1/6p1/3R4/7P/6P1/r4PK1/8 w - - 3 41",
+    "8/8/4kpp1/3p4/p2P1PP1/P3K3/8/8 b - - 0 45",
+    "6k1/5ppp/8/8/8/8/1Q3PPP/6K1 w - - 0 1",
+};
+
+//single-threaded fixed-depth searches, total nodes is the signature of the search
+static int run_search_bench(int depth) {
+    int64_t nodes = 0;
+    int64_t time = 0;
+    int64_t allocated = 0;
+    int64_t bytes = 0;
+    for(const char * fen : BENCH_FENS) {
+        Team team = Team::Alpha;
+        std::optional<ChessBoard> board = ChessBoard::from_fen(fen, &team);
+        if(!board) {
+            fprintf(stderr, "invalid bench position %s\n", fen);
+            return 1;
+        }
+        TranspositionTable table(16);//fresh per position so the order of the list does not matter
+        SearchLimits limits;
+        limits.depth = depth;
+        int64_t start_allocations = allocation_count();
+        int64_t start_bytes = allocation_bytes();
+        SearchResult result = board->search(team, limits, &table);
+        int64_t search_allocations = allocation_count() - start_allocations;
+        printf("%-70s %6s %10lld %10lld\n", fen, result.best_move ? ChessBoard::move_to_string(*result.best_move).c_str() : "-",
+               static_cast<long long>(result.nodes), static_cast<long long>(search_allocations));
+        allocated += search_allocations;
+        bytes += allocation_bytes() - start_bytes;
+        nodes += result.nodes;
+        time += result.time;
+    }
+    printf("===========================\n");
+    printf("Total time (ms) : %lld\n", static_cast<long long>(time));
+    printf("Nodes searched  : %lld\n", static_cast<long long>(nodes));
+    printf("Nodes/second    : %lld\n", static_cast<long long>(nodes * 1000 / std::max<int64_t>(time, 1)));
+    printf("Allocations     : %lld (%.2f/node, %.0f bytes/node)\n", static_cast<long long>(allocated),
+           static_cast<double>(allocated) / std::max<int64_t>(nodes, 1), static_cast<double>(bytes) / std::max<int64_t>(nodes, 1));
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 1 && std::strcmp(argv[1], "bench") == 0) {
+        return run_search_bench(argc > 2 ? std::atoi(argv[2]) : BENCH_DEPTH);
+    }
+    const char * filter = argc > 1 ? argv[1] : nullptr;//substring of the benchmarks to run
+    std::vector<std::pair<ChessBoard, Team>> positions = bench_positions();
+    print_header();
+    bench_board(positions, filter);
+    bench_eval_kernels(positions, filter);
+    return 0;
+}
@@ -1,13 +1,16 @@
 #include "chessboard.h"
-
-Piece::Piece(Team t, Rank r) {
-    this->rank = r;
-    this->team = t;
-}
-Piece::Piece() {
-    this->rank = Rank::Pawn;
-    this->team = Team::Alpha;
-}
+#include "allocationstats.h"
+#include "evalkernels.h"
+#include "pawnhash.h"
+#include "perfcounters.h"
+#include "pst.h"
+#include "transpositiontable.h"
+#include "timemanager.h"
+#include "zobrist.h"
+
+#include <cctype>
+#include <cstdio>
+#include <sstream>
 
 ChessBoard::ChessBoard()
 {
@@ -43,6 +46,59 @@ ChessBoard::ChessBoard()
     }
 
     castle_status = CASTLE_ALPHA_LEFT | CASTLE_ALPHA_RIGHT | CASTLE_BETA_LEFT | CASTLE_BETA_RIGHT;
+    halfmove_clock = 0;
+    refresh_accumulators();
+}
+
+void ChessBoard::refresh_accumulators() {
+    psq_mg = 0;
+    psq_eg = 0;
+    phase = 0;
+    zobrist = 0;
+    pawn_zobrist = 0;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x].has_value()) continue;
+            Piece p = board[y][x].value();
+            psq_mg += PIECE_SQUARE_TABLES.mg[p.team][p.rank][x + y*8];
+            psq_eg += PIECE_SQUARE_TABLES.eg[p.team][p.rank][x + y*8];
+            phase += PHASE_WEIGHT[p.rank];
+            zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][x + y*8];
+            if(p.rank == Rank::Pawn || p.rank == Rank::King) pawn_zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][x + y*8];
+        }
+    }
+}
+
+void ChessBoard::place(QPoint index, std::optional<Piece> piece) {
+    std::optional<Piece> &square = this->at(index);
+    int i = index.x() + index.y()*8;
+    if(square.has_value()) {
+        Piece p = square.value();
+        psq_mg -= PIECE_SQUARE_TABLES.mg[p.team][p.rank][i];
+        psq_eg -= PIECE_SQUARE_TABLES.eg[p.team][p.rank][i];
+        phase -= PHASE_WEIGHT[p.rank];
+        zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][i];
+        if(p.rank == Rank::Pawn || p.rank == Rank::King) pawn_zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][i];
+    }
+    square = piece;
+    if(piece.has_value()) {
+        Piece p = piece.value();
+        psq_mg += PIECE_SQUARE_TABLES.mg[p.team][p.rank][i];
+        psq_eg += PIECE_SQUARE_TABLES.eg[p.team][p.rank][i];
+        phase += PHASE_WEIGHT[p.rank];
+        zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][i];
+        if(p.rank == Rank::Pawn || p.rank == Rank::King) pawn_zobrist ^= ZOBRIST_KEYS.piece[p.team][p.rank][i];
+    }
+}
+
+uint64_t ChessBoard::key(Team to_move) {
+    uint64_t retval = zobrist ^ ZOBRIST_KEYS.castle[castle_status & 15];
+    if(to_move == Team::Beta) retval ^= ZOBRIST_KEYS.beta_to_move;
+    return retval;
+}
+
+int ChessBoard::get_halfmove_clock() {
+    return halfmove_clock;
 }
 
 bool ChessBoard::do_move(Move m) {
@@ -67,8 +123,11 @@ bool ChessBoard::do_move(Move m) {
         if(m.origin == QPoint(7,7)) this->castle_status = this->castle_status & ~CASTLE_ALPHA_RIGHT;
     }
 
-    this->at(m.destination) = this->at(m.origin);
-    this->at(m.origin) = std::nullopt;
+    if(m.piece.rank == Rank::Pawn || this->at(m.destination).has_value()) halfmove_clock = 0;
+    else halfmove_clock++;
+
+    this->place(m.destination, this->at(m.origin));
+    this->place(m.origin, std::nullopt);
     return true;
 }
 
@@ -84,38 +143,163 @@ std::optional<Piece>& ChessBoard::at(int x, int y) {
 }
 
 std::vector<ChessBoard> ChessBoard::gen_filtered_children_boards(Team t) {
-    std::vector<Move> all_children = gen_all_children_moves(t);
+    if(t == Team::Alpha) return gen_filtered_children_boards<Team::Alpha>();
+    else return gen_filtered_children_boards<Team::Beta>();
+}
+
+template<Team T>
+std::vector<ChessBoard> ChessBoard::gen_filtered_children_boards() {
+    std::vector<Move> legal_moves = gen_filtered_children_moves<T>();
     std::vector<ChessBoard> retval;
-    retval.reserve(BRANCHING_FACTOR*2);
+    retval.reserve(legal_moves.size());
 
-    for(int i = 0; i < all_children.size(); i++) {
-        if(!valid_move(all_children[i])) continue;
-        ChessBoard temp_board = *this;
-        temp_board.do_move(all_children[i]);
-        bool check_state = temp_board.get_check(t);
-        if(!check_state) {
-            retval.push_back(temp_board);
-        }
+    for(int i = 0; i < legal_moves.size(); i++) {
+        retval.push_back(*this);
+        retval.back().do_move(legal_moves[i]);
     }
     return retval;
 }
 
 std::vector<Move> ChessBoard::gen_filtered_children_moves(Team t) {
-    std::vector<Move> all_children = gen_all_children_moves(t);
+    if(t == Team::Alpha) return gen_filtered_children_moves<Team::Alpha>();
+    else return gen_filtered_children_moves<Team::Beta>();
+}
+
+//only legal moves: the king may not step onto attacked squares, other pieces must resolve
+//any check and stay on their pin line. Masks are computed once instead of trying every move
+template<Team T>
+std::vector<Move> ChessBoard::gen_filtered_children_moves() {
+    PERF_SCOPE(PerfPhase::LegalMoves);
+    ALLOC_SITE(AllocSite::MoveGeneration);
+    std::vector<Move> all_children = gen_all_children_moves<T>();
     std::vector<Move> retval;
+    retval.reserve(all_children.size());
+
+    LegalMasks masks = gen_legal_masks<T>();
+    if(masks.king < 0) return retval;
 
     for(int i = 0; i < all_children.size(); i++) {
-        if(!valid_move(all_children[i])) continue;
-        ChessBoard temp_board = *this;
-        temp_board.do_move(all_children[i]);
-        bool check_state = temp_board.get_check(t);
-        if(!check_state) {
-            retval.push_back(all_children[i]);
+        const Move &m = all_children[i];
+        if(!valid_move(m)) continue;
+        int from = m.origin.x() + m.origin.y()*8;
+        uint64_t to = 1ull << (m.destination.x() + m.destination.y()*8);
+        if(from == masks.king) {
+            if(masks.attacked & to) continue;
         }
+        else {
+            if(!(masks.check_mask & to)) continue;
+            bool pin_broken = false;
+            for(int p = 0; p < masks.pin_count; p++) {
+                if(masks.pinned[p] == from && !(masks.pin_ray[p] & to)) pin_broken = true;
+            }
+            if(pin_broken) continue;
+        }
+        retval.push_back(m);
     }
     return retval;
 }
 
+template<Team T>
+ChessBoard::LegalMasks ChessBoard::gen_legal_masks() {
+    constexpr Team opponent = T == Team::Alpha ? Team::Beta : Team::Alpha;
+    constexpr int enemy_pawn_direction = T == Team::Alpha ? 1 : -1;
+    static constexpr int knight_offsets[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+
+    LegalMasks masks = {};
+    masks.king = -1;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(board[y][x].has_value() && board[y][x].value() == Piece{T, Rank::King}) masks.king = x + y*8;
+        }
+    }
+    if(masks.king < 0) return masks;
+    int king_x = masks.king % 8;
+    int king_y = masks.king / 8;
+    uint64_t king_bit = 1ull << masks.king;
+
+    //attacked squares and checkers; sliders see through our king so it cannot retreat along their ray
+    int checkers = 0;
+    uint64_t check_mask = 0;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x].has_value() || board[y][x].value().team != opponent) continue;
+            uint64_t origin_bit = 1ull << (x + y*8);
+            Rank rank = board[y][x].value().rank;
+            if(rank == Rank::Pawn || rank == Rank::Knight || rank == Rank::King) {
+                uint64_t attacks = 0;
+                if(rank == Rank::Pawn) {
+                    if(in_bounds(QPoint(x-1, y+enemy_pawn_direction))) attacks |= 1ull << (x-1 + (y+enemy_pawn_direction)*8);
+                    if(in_bounds(QPoint(x+1, y+enemy_pawn_direction))) attacks |= 1ull << (x+1 + (y+enemy_pawn_direction)*8);
+                }
+                else {
+                    for(int i = 0; i < 8; i++) {
+                        int dx = rank == Rank::Knight ? knight_offsets[i][0] : (i < 4 ? diagonals[i][0] : cardinals[i-4][0]);
+                        int dy = rank == Rank::Knight ? knight_offsets[i][1] : (i < 4 ? diagonals[i][1] : cardinals[i-4][1]);
+                        if(in_bounds(QPoint(x+dx, y+dy))) attacks |= 1ull << (x+dx + (y+dy)*8);
+                    }
+                }
+                masks.attacked |= attacks;
+                if(attacks & king_bit) {
+                    checkers++;
+                    check_mask |= origin_bit;
+                }
+                continue;
+            }
+            for(int i = 0; i < 8; i++) {
+                bool diagonal = i < 4;
+                if(diagonal && rank == Rank::Rook) continue;
+                if(!diagonal && rank == Rank::Bishop) continue;
+                int dx = diagonal ? diagonals[i][0] : cardinals[i-4][0];
+                int dy = diagonal ? diagonals[i][1] : cardinals[i-4][1];
+                uint64_t ray = origin_bit;
+                bool through_king = false;
+                for(int step = 1; in_bounds(QPoint(x + dx*step, y + dy*step)); step++) {
+                    int square = x + dx*step + (y + dy*step)*8;
+                    masks.attacked |= 1ull << square;
+                    if(square == masks.king) {
+                        checkers++;
+                        check_mask |= ray;
+                        through_king = true;
+                        continue;
+                    }
+                    if(!through_king) ray |= 1ull << square;
+                    if(board[square/8][square%8].has_value()) break;
+                }
+            }
+        }
+    }
+    if(checkers == 0) masks.check_mask = ~0ull;
+    else if(checkers == 1) masks.check_mask = check_mask;
+    else masks.check_mask = 0;//double check, only the king can move
+
+    //pins: walk out from the king, an own piece followed by a matching enemy slider is pinned to that line
+    for(int i = 0; i < 8; i++) {
+        bool diagonal = i < 4;
+        int dx = diagonal ? diagonals[i][0] : cardinals[i-4][0];
+        int dy = diagonal ? diagonals[i][1] : cardinals[i-4][1];
+        int own = -1;
+        uint64_t ray = 0;
+        for(int step = 1; in_bounds(QPoint(king_x + dx*step, king_y + dy*step)); step++) {
+            int square = king_x + dx*step + (king_y + dy*step)*8;
+            ray |= 1ull << square;
+            if(!board[square/8][square%8].has_value()) continue;
+            Piece p = board[square/8][square%8].value();
+            if(p.team == T) {
+                if(own >= 0) break;
+                own = square;
+                continue;
+            }
+            bool slides_here = p.rank == Rank::Queen || (diagonal ? p.rank == Rank::Bishop : p.rank == Rank::Rook);
+            if(own >= 0 && slides_here) {
+                masks.pinned[masks.pin_count] = own;
+                masks.pin_ray[masks.pin_count] = ray;
+                masks.pin_count++;
+            }
+            break;
+        }
+    }
+    return masks;
+}
 
 std::vector<ChessBoard> ChessBoard::gen_all_children_boards(Team t) {
     std::vector<ChessBoard> retval;
@@ -181,18 +365,26 @@ std::vector<ChessBoard> ChessBoard::gen_all_children_boards(Team t) {
 }
 
 std::vector<Move> ChessBoard::gen_all_children_moves(Team t) {
+    if(t == Team::Alpha) return gen_all_children_moves<Team::Alpha>();
+    else return gen_all_children_moves<Team::Beta>();
+}
+
+template<Team T>
+std::vector<Move> ChessBoard::gen_all_children_moves() {
+    PERF_SCOPE(PerfPhase::MoveGeneration);
+    ALLOC_SITE(AllocSite::MoveGeneration);
     std::vector<Move> retval;
     retval.reserve(BRANCHING_FACTOR*2);
     for(int x = 0; x < 8; x++) {
         for(int y = 0; y < 8; y++) {
             if(!board[y][x]) continue;
-            if(board[y][x].value().team != t) continue;
+            if(board[y][x].value().team != T) continue;
             std::vector<Move> temp_moves;
             //TODO: check for mate condition
             QPoint location(x, y);
             switch(board[y][x].value().rank) {
             case Rank::Pawn:
-                temp_moves = gen_pawn_moves(location);
+                temp_moves = gen_pawn_moves<T>(location);
                 break;
             case Rank::Knight:
                 temp_moves = gen_knight_moves(location);
@@ -218,27 +410,17 @@ std::vector<Move> ChessBoard::gen_all_children_moves(Team t) {
         }
     }
 
-    if(t == Team::Alpha) {
-        if(castle_status & CASTLE_ALPHA_LEFT) {
-            if(!(board[7][1].has_value() || board[7][2].has_value() || board[7][3].has_value())) {
-                //retval.push_back();
-            }
+    constexpr int home_rank = T == Team::Alpha ? 7 : 0;
+    constexpr char castle_left = T == Team::Alpha ? CASTLE_ALPHA_LEFT : CASTLE_BETA_LEFT;
+    constexpr char castle_right = T == Team::Alpha ? CASTLE_ALPHA_RIGHT : CASTLE_BETA_RIGHT;
+    if(castle_status & castle_left) {
+        if(!(board[home_rank][1].has_value() || board[home_rank][2].has_value() || board[home_rank][3].has_value())) {
+            //retval.push_back();
         }
-        if(castle_status & CASTLE_ALPHA_RIGHT) {
-            if(!(board[7][5].has_value() || board[7][6].has_value())) {
-                //
-            }
-        }
-    } else {
-        if(castle_status & CASTLE_BETA_LEFT) {
-            if(!(board[0][1].has_value() || board[0][2].has_value() || board[0][3].has_value())) {
-                //
-            }
-        }
-        if(castle_status & CASTLE_BETA_RIGHT) {
-            if(!(board[0][5].has_value() || board[0][6].has_value())) {
-                //
-            }
+    }
+    if(castle_status & castle_right) {
+        if(!(board[home_rank][5].has_value() || board[home_rank][6].has_value())) {
+            //
         }
     }
 
@@ -246,6 +428,13 @@ std::vector<Move> ChessBoard::gen_all_children_moves(Team t) {
 }
 
 bool ChessBoard::get_check(Team t) {
+    if(t == Team::Alpha) return get_check<Team::Alpha>();
+    else return get_check<Team::Beta>();
+}
+
+template<Team T>
+bool ChessBoard::get_check() {
+    PERF_SCOPE(PerfPhase::CheckDetection);
     //TODO: check outward from king
     QPoint king_location;
 
@@ -253,7 +442,7 @@ bool ChessBoard::get_check(Team t) {
     for(int x = 0; x < 8; x++) {
         for(int y = 0; y < 8; y++) {
             if(board[y][x].has_value()) {
-                if(board[y][x].value() == Piece{t, Rank::King}) {
+                if(board[y][x].value() == Piece{T, Rank::King}) {
                     king_location = QPoint(x, y);
                     king_found = true;
                 }
@@ -265,7 +454,7 @@ bool ChessBoard::get_check(Team t) {
         return true;
     }
 
-    Team opponent = team_inverse(t);
+    constexpr Team opponent = T == Team::Alpha ? Team::Beta : Team::Alpha;
 
     std::vector<Move> diag = this->gen_diagonal_moves(king_location, true);
     for(Move m : diag) {
@@ -303,14 +492,7 @@ bool ChessBoard::get_check(Team t) {
         }
     }
 
-    int pawn_direction = 0;
-
-    if(t == Team::Alpha) {
-        pawn_direction = -1;
-    }
-    else {
-        pawn_direction = 1;
-    }
+    constexpr int pawn_direction = T == Team::Alpha ? -1 : 1;
 
     QPoint pawn_left = king_location + QPoint(1,pawn_direction);
     QPoint pawn_right = king_location + QPoint(-1,pawn_direction);
@@ -408,34 +590,22 @@ std::vector<ChessBoard> ChessBoard::gen_pawn_boards(QPoint origin) {
     return temp_boards;
 }
 
+template<Team T>
 std::vector<Move> ChessBoard::gen_pawn_moves(QPoint origin) {
+    constexpr int pawn_direction = T == Team::Alpha ? -1 : 1;
+    constexpr int start_rank = T == Team::Alpha ? 6 : 1;
     Move temp_move;
     std::vector<Move> retval;
     retval.reserve(3);
-    int pawn_direction;
     QPoint dest;
 
     //double jump
-    if(board[origin.y()][origin.x()].value().team == Team::Alpha) {
-        //
-        pawn_direction = -1;
-        dest = origin + QPoint(0, -2);
-        if(origin.y() == 6 && in_bounds(dest) && !this->at(origin + QPoint(0,-1)).has_value() && !this->at(dest).has_value()) {
-            temp_move = Move{board[origin.y()][origin.x()].value(), origin, dest};
-            if (this->in_bounds(temp_move.destination))
-            {retval.push_back(temp_move);}
-        }
-        //TODO: add en passant here
-    }
-    else {
-        pawn_direction = 1;
-        dest = origin + QPoint(0, 2);
-        if(origin.y() == 1 && in_bounds(dest) && !this->at(origin + QPoint(0,1)).has_value() && !this->at(dest).has_value()) {
-            temp_move = Move{board[origin.y()][origin.x()].value(), origin, dest};
-            if (this->in_bounds(temp_move.destination))
-            {retval.push_back(temp_move);}
-        }
+    dest = origin + QPoint(0, 2*pawn_direction);
+    if(origin.y() == start_rank && !this->at(origin + QPoint(0,pawn_direction)).has_value() && !this->at(dest).has_value()) {
+        temp_move = Move{board[origin.y()][origin.x()].value(), origin, dest};
+        retval.push_back(temp_move);
     }
+    //TODO: add en passant here
 
 
     dest = origin + QPoint(0,pawn_direction);
@@ -453,13 +623,13 @@ std::vector<Move> ChessBoard::gen_pawn_moves(QPoint origin) {
 
     //L and R flanks
     if(in_bounds(left_dest) && this->at(left_dest).has_value()) {
-        if(this->at(left_dest).value().team != this->at(origin).value().team) {
+        if(this->at(left_dest).value().team != T) {
             temp_move = Move{board[origin.y()][origin.x()].value(), origin, left_dest};
             if (this->in_bounds(temp_move.destination)) retval.push_back(temp_move);
         }
     }
     if(in_bounds(right_dest) && this->at(right_dest).has_value()) {
-        if(this->at(right_dest).value().team != this->at(origin).value().team) {
+        if(this->at(right_dest).value().team != T) {
             temp_move = Move{board[origin.y()][origin.x()].value(), origin, right_dest};
             if (this->in_bounds(temp_move.destination)) retval.push_back(temp_move);
         }
@@ -617,14 +787,386 @@ Team team_inverse(Team t) {
     else return Team::Alpha;
 }
 
-int ChessBoard::heuristic(Team team) {
-    int piece_sum = 0;
-    for(int x = 0; x < 8; x++) {
-        for(int y = 0; y < 8; y++) {
+int ChessBoard::centipawns(int score) {
+    //leaf scores are heuristic() * DEPTH_BONUS
+    return score / (MATERIAL_COEFFICIENT / 100 * DEPTH_BONUS);
+}
+
+std::optional<ChessBoard> ChessBoard::from_fen(const std::string &fen, Team * to_move) {
+    static const std::string rank_letters = "pnbrqk";
+    std::istringstream fields(fen);
+    std::string placement;
+    std::string side = "w";
+    std::string castling = "-";
+    std::string en_passant = "-";
+    int halfmoves = 0;
+    fields >> placement >> side >> castling >> en_passant >> halfmoves;
+
+    ChessBoard retval;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            retval.board[y][x] = std::nullopt;
+        }
+    }
+    int x = 0;
+    int y = 0;
+    for(char c : placement) {
+        if(c == '/') {
+            if(x != 8) return std::nullopt;
+            y++;
+            x = 0;
+            continue;
+        }
+        if(c >= '1' && c <= '8') {
+            x += c - '0';
+            if(x > 8) return std::nullopt;
+            continue;
+        }
+        size_t rank = rank_letters.find(std::tolower(static_cast<unsigned char>(c)));
+        if(rank == std::string::npos || x > 7 || y > 7) return std::nullopt;
+        retval.board[y][x] = Piece{std::isupper(static_cast<unsigned char>(c)) ? Team::Alpha : Team::Beta, static_cast<Rank>(rank)};
+        x++;
+    }
+    if(y != 7 || x != 8) return std::nullopt;
+    if(side != "w" && side != "b") return std::nullopt;
+
+    retval.castle_status = 0;
+    for(char c : castling) {
+        if(c == 'K') retval.castle_status |= CASTLE_ALPHA_RIGHT;
+        if(c == 'Q') retval.castle_status |= CASTLE_ALPHA_LEFT;
+        if(c == 'k') retval.castle_status |= CASTLE_BETA_RIGHT;
+        if(c == 'q') retval.castle_status |= CASTLE_BETA_LEFT;
+    }
+    retval.halfmove_clock = std::max(halfmoves, 0);
+    retval.refresh_accumulators();
+    if(to_move) *to_move = side == "w" ? Team::Alpha : Team::Beta;
+    return retval;
+}
+
+std::string ChessBoard::to_fen(Team to_move) {
+    static const std::string rank_letters = "pnbrqk";
+    std::string retval;
+    for(int y = 0; y < 8; y++) {
+        int empty = 0;
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x].has_value()) {
+                empty++;
+                continue;
+            }
+            if(empty) retval += static_cast<char>('0' + empty);
+            empty = 0;
+            char letter = rank_letters[board[y][x].value().rank];
+            retval += board[y][x].value().team == Team::Alpha ? static_cast<char>(std::toupper(letter)) : letter;
+        }
+        if(empty) retval += static_cast<char>('0' + empty);
+        if(y < 7) retval += '/';
+    }
+    retval += to_move == Team::Alpha ? " w " : " b ";
+    std::string castling;
+    if(castle_status & CASTLE_ALPHA_RIGHT) castling += 'K';
+    if(castle_status & CASTLE_ALPHA_LEFT) castling += 'Q';
+    if(castle_status & CASTLE_BETA_RIGHT) castling += 'k';
+    if(castle_status & CASTLE_BETA_LEFT) castling += 'q';
+    retval += castling.empty() ? "-" : castling;
+    retval += " - " + std::to_string(halfmove_clock) + " 1";
+    return retval;
+}
+
+std::string ChessBoard::move_to_string(Move m) {
+    std::string retval;
+    retval += static_cast<char>('a' + m.origin.x());
+    retval += static_cast<char>('8' - m.origin.y());
+    retval += static_cast<char>('a' + m.destination.x());
+    retval += static_cast<char>('8' - m.destination.y());
+    return retval;
+}
+
+std::optional<Move> ChessBoard::parse_move(const std::string &text, Team team) {
+    if(text.size() < 4) return std::nullopt;
+    std::vector<Move> moves = gen_filtered_children_moves(team);
+    for(Move m : moves) {
+        if(move_to_string(m) == text.substr(0, 4)) return m;
+    }
+    return std::nullopt;
+}
+
+//square (x + y*8) of side's cheapest piece attacking square, counting only pieces still in occupied; -1 if none.
+//sliders look through squares removed from occupied, so x-ray attackers behind an exchanged piece show up
+int ChessBoard::least_valuable_attacker(int square, Team side, uint64_t occupied) {
+    static const int knight_jumps[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+    int tx = square % 8;
+    int ty = square / 8;
+    auto piece_at = [&](int x, int y) -> std::optional<Piece> {
+        if(x < 0 || x > 7 || y < 0 || y > 7 || !(occupied & (1ull << (x + y*8)))) return std::nullopt;
+        return board[y][x];
+    };
+    auto is = [](std::optional<Piece> p, Team t, Rank r) {
+        return p.has_value() && p->team == t && p->rank == r;
+    };
+
+    int pawn_y = side == Team::Alpha ? ty + 1 : ty - 1;//pawns capture towards the enemy
+    for(int dx : {-1, 1}) {
+        if(is(piece_at(tx + dx, pawn_y), side, Rank::Pawn)) return tx + dx + pawn_y*8;
+    }
+    for(const auto &jump : knight_jumps) {
+        if(is(piece_at(tx + jump[0], ty + jump[1]), side, Rank::Knight)) return tx + jump[0] + (ty + jump[1])*8;
+    }
+
+    //first piece along each ray
+    int diagonal_hits[4];
+    int cardinal_hits[4];
+    for(int d = 0; d < 4; d++) {
+        for(int pass = 0; pass < 2; pass++) {
+            const int (*rays)[2] = pass == 0 ? diagonals : cardinals;
+            int &hit = pass == 0 ? diagonal_hits[d] : cardinal_hits[d];
+            hit = -1;
+            int x = tx + rays[d][0];
+            int y = ty + rays[d][1];
+            while(x >= 0 && x < 8 && y >= 0 && y < 8) {
+                if(occupied & (1ull << (x + y*8))) {
+                    hit = x + y*8;
+                    break;
+                }
+                x += rays[d][0];
+                y += rays[d][1];
+            }
+        }
+    }
+    auto hit_piece = [&](int hit) -> std::optional<Piece> {
+        return hit < 0 ? std::nullopt : board[hit / 8][hit % 8];
+    };
+    for(int hit : diagonal_hits) {
+        if(is(hit_piece(hit), side, Rank::Bishop)) return hit;
+    }
+    for(int hit : cardinal_hits) {
+        if(is(hit_piece(hit), side, Rank::Rook)) return hit;
+    }
+    for(int d = 0; d < 4; d++) {
+        if(is(hit_piece(diagonal_hits[d]), side, Rank::Queen)) return diagonal_hits[d];
+        if(is(hit_piece(cardinal_hits[d]), side, Rank::Queen)) return cardinal_hits[d];
+    }
+    for(int dy = -1; dy <= 1; dy++) {
+        for(int dx = -1; dx <= 1; dx++) {
+            if((dx || dy) && is(piece_at(tx + dx, ty + dy), side, Rank::King)) return tx + dx + (ty + dy)*8;
+        }
+    }
+    return -1;
+}
+
+//swap list over the exchange on m's destination, each side capturing with its cheapest attacker
+//and free to stop whenever continuing would lose more. Pins are ignored
+int ChessBoard::see(Move m) {
+    PERF_SCOPE(PerfPhase::Exchange);
+    auto value = [](Rank r) {
+        return r == Rank::King ? SEE_KING_VALUE : MG_VALUE[r];
+    };
+    int target = m.destination.x() + m.destination.y()*8;
+    uint64_t occupied = 0;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(board[y][x].has_value()) occupied |= 1ull << (x + y*8);
+        }
+    }
+
+    int gain[32];
+    int d = 0;
+    gain[0] = this->at(m.destination).has_value() ? value(this->at(m.destination)->rank) : 0;
+    Rank on_target = m.piece.rank;
+    Team side = m.piece.team;
+    occupied &= ~(1ull << (m.origin.x() + m.origin.y()*8));
+    while(d < 31) {
+        side = team_inverse(side);
+        int from = least_valuable_attacker(target, side, occupied);
+        if(from < 0) break;
+        d++;
+        gain[d] = value(on_target) - gain[d-1];
+        occupied &= ~(1ull << from);
+        on_target = board[from / 8][from % 8]->rank;
+    }
+    while(d > 0) {
+        gain[d-1] = -std::max(-gain[d-1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+//pawn-structure features, from this thread's pawn hash when the skeleton has been seen before
+PawnStructure ChessBoard::pawn_structure() {
+    thread_local PawnHashTable table;
+    PawnStructure retval;
+    if(table.probe(pawn_zobrist, retval)) return retval;
+    PERF_SCOPE(PerfPhase::PawnStructure);
+
+    int pawns[2][8] = {};//per team and file
+    //most advanced pawn per file from each side's view: Alpha's lowest y, Beta's highest
+    int alpha_front[8];
+    int beta_front[8];
+    std::fill(std::begin(alpha_front), std::end(alpha_front), 8);
+    std::fill(std::begin(beta_front), std::end(beta_front), -1);
+    //rearmost pawn per file, the one an enemy pawn has to get past
+    int alpha_rear[8];
+    int beta_rear[8];
+    std::fill(std::begin(alpha_rear), std::end(alpha_rear), -1);
+    std::fill(std::begin(beta_rear), std::end(beta_rear), 8);
+    std::optional<QPoint> kings[2];
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
             if(!board[y][x].has_value()) continue;
-            piece_sum += board[y][x].value().value();
+            Piece p = board[y][x].value();
+            if(p.rank == Rank::King) kings[p.team] = QPoint(x, y);
+            if(p.rank != Rank::Pawn) continue;
+            pawns[p.team][x]++;
+            if(p.team == Team::Alpha) {
+                alpha_front[x] = std::min(alpha_front[x], y);
+                alpha_rear[x] = std::max(alpha_rear[x], y);
+            }
+            else {
+                beta_front[x] = std::max(beta_front[x], y);
+                beta_rear[x] = std::min(beta_rear[x], y);
+            }
+        }
+    }
+
+    int doubled[2] = {};
+    int isolated[2] = {};
+    int passed[2] = {};
+    int shelter[2] = {};
+    for(int x = 0; x < 8; x++) {
+        for(int t = 0; t < 2; t++) {
+            if(pawns[t][x] == 0) continue;
+            doubled[t] += pawns[t][x] - 1;
+            bool supported = (x > 0 && pawns[t][x-1]) || (x < 7 && pawns[t][x+1]);
+            if(!supported) isolated[t] += pawns[t][x];
+        }
+        //only the front pawn on a file can be passed, the others are behind it
+        bool alpha_passed = pawns[Team::Alpha][x] > 0;
+        bool beta_passed = pawns[Team::Beta][x] > 0;
+        for(int file = std::max(x - 1, 0); file <= std::min(x + 1, 7); file++) {
+            if(beta_rear[file] < alpha_front[x]) alpha_passed = false;
+            if(alpha_rear[file] > beta_front[x]) beta_passed = false;
+        }
+        if(alpha_passed) passed[Team::Alpha] += 6 - alpha_front[x];
+        if(beta_passed) passed[Team::Beta] += beta_front[x] - 1;
+    }
+    for(int t = 0; t < 2; t++) {
+        if(!kings[t]) continue;
+        int forward = t == Team::Alpha ? -1 : 1;
+        for(int x = std::max(kings[t]->x() - 1, 0); x <= std::min(kings[t]->x() + 1, 7); x++) {
+            for(int step = 1; step <= 2; step++) {
+                int y = kings[t]->y() + forward * step;
+                if(y < 0 || y > 7 || !board[y][x].has_value()) continue;
+                Piece p = board[y][x].value();
+                if(p.rank == Rank::Pawn && p.team == t) shelter[t]++;
+            }
+        }
+    }
+
+    retval.doubled = doubled[Team::Alpha] - doubled[Team::Beta];
+    retval.isolated = isolated[Team::Alpha] - isolated[Team::Beta];
+    retval.passed = passed[Team::Alpha] - passed[Team::Beta];
+    retval.shelter = shelter[Team::Alpha] - shelter[Team::Beta];
+    table.store(pawn_zobrist, retval);
+    return retval;
+}
+
+//the attack/defend map of heuristic() without generating moves: every occupied square one of T's
+//pseudo-legal moves lands on counts +1 if it holds an enemy piece and -1 if it holds T's own, which
+//only knight moves reach. Attacks on the enemy king add to check_sum, positive for Alpha
+template<Team T>
+void ChessBoard::accumulate_attacks(int32_t AD_map[64], int &check_sum) {
+    static const int knight_jumps[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+    constexpr int pawn_direction = T == Team::Alpha ? -1 : 1;
+    constexpr int check_sign = T == Team::Alpha ? 1 : -1;
+    auto reach = [&](int x, int y) {
+        Piece target = board[y][x].value();
+        if(target.team == T) {
+            AD_map[x + y*8] -= 1;
+            return;
+        }
+        AD_map[x + y*8] += 1;
+        if(target.rank == Rank::King) check_sum += check_sign;
+    };
+    auto slide = [&](int x, int y, const int (*rays)[2], bool extending) {
+        for(int d = 0; d < 4; d++) {
+            int tx = x + rays[d][0];
+            int ty = y + rays[d][1];
+            while(tx >= 0 && tx < 8 && ty >= 0 && ty < 8) {
+                if(board[ty][tx].has_value()) {
+                    if(board[ty][tx].value().team != T) reach(tx, ty);
+                    break;
+                }
+                if(!extending) break;
+                tx += rays[d][0];
+                ty += rays[d][1];
+            }
+        }
+    };
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x] || board[y][x].value().team != T) continue;
+            switch(board[y][x].value().rank) {
+            case Rank::Pawn:
+                //pushes only go to empty squares
+                for(int dx : {-1, 1}) {
+                    int tx = x + dx;
+                    int ty = y + pawn_direction;
+                    if(tx >= 0 && tx < 8 && ty >= 0 && ty < 8 && board[ty][tx].has_value() && board[ty][tx].value().team != T) reach(tx, ty);
+                }
+                break;
+            case Rank::Knight:
+                for(const auto &jump : knight_jumps) {
+                    int tx = x + jump[0];
+                    int ty = y + jump[1];
+                    if(tx >= 0 && tx < 8 && ty >= 0 && ty < 8 && board[ty][tx].has_value()) reach(tx, ty);
+                }
+                break;
+            case Rank::Bishop:
+                slide(x, y, diagonals, true);
+                break;
+            case Rank::Rook:
+                slide(x, y, cardinals, true);
+                break;
+            case Rank::Queen:
+                slide(x, y, diagonals, true);
+                slide(x, y, cardinals, true);
+                break;
+            case Rank::King:
+                slide(x, y, diagonals, false);
+                slide(x, y, cardinals, false);
+                break;
+            }
         }
     }
+}
+
+int ChessBoard::heuristic(Team team) {
+    static const EvalParams defaults;
+    return heuristic(team, defaults);
+}
+
+int ChessBoard::heuristic(Team team, const EvalParams &params) {
+    Q_UNUSED(team);
+    PERF_SCOPE(PerfPhase::Evaluation);
+    ALLOC_SITE(AllocSite::Evaluation);
+    //the accumulators hold the pst.h material, params may move it
+    int material_mg = 0;
+    int material_eg = 0;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x].has_value() || board[y][x].value().rank == Rank::King) continue;
+            Piece p = board[y][x].value();
+            int sign = p.team == Team::Alpha ? 1 : -1;
+            material_mg += sign * (params.weights[EvalParams::PawnMaterialMg + p.rank] - MG_VALUE[p.rank]);
+            material_eg += sign * (params.weights[EvalParams::PawnMaterialEg + p.rank] - EG_VALUE[p.rank]);
+        }
+    }
+    //middlegame and endgame piece-square sums blended by how much material is left
+    int game_phase = std::min(phase, PHASE_TOTAL);
+    PawnStructure pawns = pawn_structure();
+    int pawn_common = -pawns.doubled * params.weights[EvalParams::DoubledPawn] - pawns.isolated * params.weights[EvalParams::IsolatedPawn];
+    int pawn_mg = pawn_common + pawns.passed * params.weights[EvalParams::PassedPawn] / 2 + pawns.shelter * params.weights[EvalParams::KingShelter];
+    int pawn_eg = pawn_common + pawns.passed * params.weights[EvalParams::PassedPawn];
+    int tapered = ((psq_mg + material_mg + pawn_mg) * game_phase + (psq_eg + material_eg + pawn_eg) * (PHASE_TOTAL - game_phase)) / PHASE_TOTAL;
 
     /*
     std::pair<bool, int> cod_offense = get_cod(team);//attacks that t can make
@@ -656,126 +1198,407 @@ int ChessBoard::heuristic(Team team) {
     */
 
 #ifndef MATERIAL_ONLY
-    std::vector<Move> alpha_moves = gen_all_children_moves(Team::Alpha);
-    std::vector<Move> beta_moves = gen_all_children_moves(Team::Beta);
-    int AD_map[64] = {};
-    int check_sum = 0;
-    int AD_sum = 0;
-
-    //if A's turn:
-    //  attacks
-
-    for(Move move : alpha_moves) {
-        if(this->at(move.destination).has_value()) {
-            int AD_index = move.destination.x() + move.destination.y() * 8;
-            Piece dest_piece = this->at(move.destination).value();
-            //AD_sum += dest_piece.value();
-            if(dest_piece.team == Team::Beta) {//if attack
-                AD_map[AD_index] += 1;
-                //AD_sum += 1;
-                if(dest_piece.rank == Rank::King) check_sum++;
-            } else {
-                AD_map[AD_index] -= 1;
-            }
-        }
-    }
-    for(Move move : beta_moves) {
-        if(this->at(move.destination).has_value()) {
-            int AD_index = move.destination.x() + move.destination.y() * 8;
-            Piece dest_piece = this->at(move.destination).value();
-            //AD_sum -= dest_piece.value();
-            if(dest_piece.team == Team::Alpha) {//if attack
-                AD_map[AD_index] += 1;
-                //AD_sum -= 1;
-                if(dest_piece.rank == Rank::King) check_sum--;
-            } else {
-                AD_map[AD_index] -= 1;
+    //flat signed piece values so the square reductions can be vectorized
+    alignas(32) int32_t values[64];
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            if(!board[y][x].has_value()) {
+                values[x + y*8] = 0;
+                continue;
             }
+            Piece p = board[y][x].value();
+            values[x + y*8] = p.team == Team::Alpha ? params.attack_value(p.rank) : -params.attack_value(p.rank);
         }
     }
 
-    for(int x = 0; x < 8; x++) {
-        for(int y = 0; y < 8; y++) {
-            if(AD_map[x + y*8] > 0) {//if being attacked
-                AD_sum -= this->at(x, y).value().value();
-            }
-            if(AD_map[x+y*8] < 0) {//if being defended
-                AD_sum += this->at(x,y).value().value();
-            }
-        }
-    }
+    alignas(32) int32_t AD_map[64] = {};
+    int check_sum = 0;
+    accumulate_attacks<Team::Alpha>(AD_map, check_sum);
+    accumulate_attacks<Team::Beta>(AD_map, check_sum);
 
+    int AD_sum = eval_attack_defend_sum(values, AD_map);
 
 
-    int retval = piece_sum * MATERIAL_COEFFICIENT + AD_sum * ATTACK_DEFEND_COEFFICIENT + check_sum * CHECK_COEFFICIENT; //offense_val + defense_val + check_val;
+
+    int retval = tapered * params.weights[EvalParams::MaterialCoefficient] / 100
+            + AD_sum * params.weights[EvalParams::AttackDefendCoefficient]
+            + check_sum * params.weights[EvalParams::CheckCoefficient]; //offense_val + defense_val + check_val;
 #else
-    int retval = piece_sum * MATERIAL_COEFFICIENT;
+    int retval = tapered * params.weights[EvalParams::MaterialCoefficient] / 100;
 #endif
     this->stored_heuristic = retval;
 
     return retval;
 }
 
+bool SearchContext::should_stop() {
+    if(stop && stop->load(std::memory_order_relaxed)) return true;
+    if(node_limit > 0 && nodes >= node_limit) return true;
+    if(deadline && std::chrono::steady_clock::now() >= *deadline) return true;
+    return false;
+}
+
 int ChessBoard::alpha_beta(Team team) {
-    return alpha_beta(1, team, INT_MIN, INT_MAX);
+    SearchContext ctx;
+#ifdef ASPIRATION_WINDOWS
+    //iterative deepening, each iteration searched inside a window around the previous score
+    int score = 0;
+    for(int cutoff = (DEPTH_CUTOFF - 1) % ITERATION_STEP + 1; cutoff <= DEPTH_CUTOFF; cutoff += ITERATION_STEP) {
+        score = search_iteration(ctx, cutoff, team, score);
+    }
+    return score;
+#else
+    return alpha_beta(ctx, 1, DEPTH_CUTOFF, team, INT_MIN, INT_MAX);
+#endif
 }
 
 int ChessBoard::alpha_beta(int depth, Team team, int alpha, int beta) {
-    int depth_score = DEPTH_CUTOFF - depth + 1;
+    return alpha_beta(depth, DEPTH_CUTOFF, team, alpha, beta);
+}
+
+int ChessBoard::alpha_beta(int depth, int cutoff, Team team, int alpha, int beta) {
+    SearchContext ctx;
+    return alpha_beta(ctx, depth, cutoff, team, alpha, beta);
+}
+
+int ChessBoard::alpha_beta(SearchContext &ctx, int depth, int cutoff, Team team, int alpha, int beta) {
+    if(team == Team::Alpha) return alpha_beta<Team::Alpha>(ctx, depth, cutoff, alpha, beta);
+    else return alpha_beta<Team::Beta>(ctx, depth, cutoff, alpha, beta);
+}
+
+//one iteration inside an aspiration window around the previous score, widened on failure
+int ChessBoard::search_iteration(SearchContext &ctx, int cutoff, Team team, int previous_score) {
+    if(cutoff < ASPIRATION_MIN_DEPTH) return alpha_beta(ctx, 1, cutoff, team, INT_MIN, INT_MAX);
+    int delta = ASPIRATION_WINDOW;
+    int alpha = previous_score - delta;
+    int beta = previous_score + delta;
+    while(true) {
+        int score = alpha_beta(ctx, 1, cutoff, team, alpha, beta);
+        if(ctx.aborted) return score;
+        if(score <= alpha) alpha = delta > ASPIRATION_LIMIT ? INT_MIN : score - delta;//fail low
+        else if(score >= beta) beta = delta > ASPIRATION_LIMIT ? INT_MAX : score + delta;//fail high
+        else return score;
+        delta *= 4;
+    }
+}
+
+SearchResult ChessBoard::search(Team team, const SearchLimits &limits, TranspositionTable * table,
+                                const std::atomic<bool> * stop,
+                                const std::function<void(const SearchResult &)> &on_iteration,
+                                const std::vector<uint64_t> &history) {
+    ALLOC_SITE(AllocSite::Search);
+#ifdef ALLOC_TRACKING
+    AllocationStats allocations_before = thread_allocations();
+#endif
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]{
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    SearchContext ctx;
+    ctx.table = table;
+    ctx.stop = stop;
+    ctx.node_limit = limits.nodes;
+    ctx.history = history;
+    ctx.multipv = std::max(limits.multipv, 1);
+    if(limits.movetime > 0) ctx.deadline = start + std::chrono::milliseconds(limits.movetime);
+    std::optional<TimeManager> clock;
+    if(limits.time_left > 0) {
+        clock.emplace(limits.time_left, limits.increment, limits.moves_to_go);
+        auto hard_deadline = start + std::chrono::milliseconds(clock->hard_budget());
+        if(!ctx.deadline || hard_deadline < *ctx.deadline) ctx.deadline = hard_deadline;
+    }
+
+    //a one ply search would stop at the root without choosing a move
+    int max_depth = std::max(limits.depth > 0 ? limits.depth : clock ? MAX_TIMED_DEPTH : DEPTH_CUTOFF, 2);
+    SearchResult result;
+    std::vector<Move> root_moves = gen_filtered_children_moves(team);
+    if(root_moves.empty()) {
+        //a mate is scaled like one found at the root of a max_depth tree, so it outranks the mates
+        //a deeper search of a sibling position finds when the caller compares the two
+        if(get_check(team)) result.score = alpha_beta(ctx, 1, max_depth, team, INT_MIN, INT_MAX);
+        else result.score = DRAW_SCORE;//stalemate
+        result.nodes = ctx.nodes;
+        return result;
+    }
+    result.best_move = root_moves[0];//in case even the first iteration is cut short
+
+    int score = 0;
+    for(int cutoff = (max_depth - 1) % ITERATION_STEP + 1; cutoff <= max_depth; cutoff += ITERATION_STEP) {
+        if(cutoff < 2) continue;
+        PERF_SCOPE(PerfPhase::Search);
+        ctx.root_best.reset();
+        ctx.root_scores.clear();
+        //several exact root scores do not fit in one aspiration window
+        if(ctx.multipv > 1) score = alpha_beta(ctx, 1, cutoff, team, INT_MIN, INT_MAX);
+        else score = search_iteration(ctx, cutoff, team, score);
+        if(ctx.aborted) break;
+        result.score = score;
+        result.depth = cutoff;
+        if(ctx.root_best) result.best_move = ctx.root_best;
+        result.lines.clear();
+        if(ctx.multipv > 1) {
+            for(const std::pair<Move, int> &line : ctx.root_scores) {
+                result.lines.push_back(PrincipalVariation{line.first, line.second, hash_line(table, team, line.first, cutoff)});
+            }
+        }
+        else if(result.best_move) {
+            result.lines.push_back(PrincipalVariation{*result.best_move, score, hash_line(table, team, *result.best_move, cutoff)});
+        }
+        result.nodes = ctx.nodes;
+        result.time = elapsed();
+        if(on_iteration) on_iteration(result);
+        if(clock && result.best_move) {
+            clock->iteration_finished(*result.best_move, score, team, result.time);
+            if(!clock->start_next_iteration(elapsed())) break;
+        }
+    }
+    result.nodes = ctx.nodes;
+    result.time = elapsed();
+#ifdef ALLOC_TRACKING
+    AllocationStats allocations = thread_allocations() - allocations_before;
+    result.allocations = allocations.total_count();
+    result.allocated_bytes = allocations.total_bytes();
+    fprintf(stderr, "search: depth %d, %lld nodes, %lld allocations\n%s", result.depth, static_cast<long long>(result.nodes),
+            static_cast<long long>(result.allocations), allocation_report(allocations, result.nodes).c_str());
+#endif
+#ifdef PERF_COUNTERS
+    fprintf(stderr, "search: depth %d, %lld nodes, %lld ms\n%s", result.depth, static_cast<long long>(result.nodes),
+            static_cast<long long>(result.time), perf_report().c_str());
+    perf_reset();
+#endif
+    return result;
+}
+
+//only positions since the last irreversible move can repeat, the key tells the sides to move apart
+std::optional<int> ChessBoard::rule_draw_score(Team to_move, const std::vector<uint64_t> &history) {
+    if(halfmove_clock >= FIFTY_MOVE_PLIES) return DRAW_SCORE;
+    uint64_t hash = this->key(to_move);
+    int oldest = std::max(0, static_cast<int>(history.size()) - halfmove_clock);
+    for(int i = static_cast<int>(history.size()) - 1; i >= oldest; i--) {
+        if(history[i] == hash) return DRAW_SCORE;
+    }
+    return std::nullopt;
+}
+
+//the root move followed by the hash moves stored below it, stopping at a miss or a repeat
+std::vector<Move> ChessBoard::hash_line(TranspositionTable * table, Team team, Move first, int length) {
+    std::vector<Move> line{first};
+    if(!table) return line;
+    ChessBoard position = *this;
+    position.do_move(first);
+    Team side = team_inverse(team);
+    std::vector<uint64_t> seen{this->key(team)};
+    while(static_cast<int>(line.size()) < length) {
+        uint64_t hash = position.key(side);
+        if(std::find(seen.begin(), seen.end(), hash) != seen.end()) break;
+        seen.push_back(hash);
+        TranspositionTable::Entry entry;
+        if(!table->probe(hash, entry) || entry.move_origin < 0) break;
+        std::optional<Move> next;
+        for(Move m : position.gen_filtered_children_moves(side)) {
+            if(m.origin.x() + m.origin.y()*8 == entry.move_origin && m.destination.x() + m.destination.y()*8 == entry.move_destination) next = m;
+        }
+        if(!next) break;
+        line.push_back(*next);
+        position.do_move(*next);
+        side = team_inverse(side);
+    }
+    return line;
+}
+
+template<Team T>
+int ChessBoard::alpha_beta(SearchContext &ctx, int depth, int cutoff, int alpha, int beta) {
+    constexpr Team opponent = T == Team::Alpha ? Team::Beta : Team::Alpha;
+    ctx.nodes++;
+    if(ctx.aborted || ((ctx.nodes & 1023) == 0 && ctx.should_stop())) {
+        ctx.aborted = true;
+        return 0;
+    }
+
+    int depth_score = cutoff - depth + 1;
 
     depth_score *= DEPTH_BONUS;
 
-    std::vector<ChessBoard> children = this->gen_filtered_children_boards(team);
-    if(children.size() == 0) {
+    uint64_t hash = this->key(T);
+    if(depth > 1) {
+        if(halfmove_clock >= FIFTY_MOVE_PLIES) return DRAW_SCORE;
+        //a repeat within the search is scored as the draw it can be forced into,
+        //only positions since the last irreversible move with the same side to move can match
+        int oldest = std::max(0, static_cast<int>(ctx.history.size()) - halfmove_clock);
+        for(int i = static_cast<int>(ctx.history.size()) - 2; i >= oldest; i -= 2) {
+            if(ctx.history[i] == hash) return DRAW_SCORE;
+        }
+    }
+
+    int remaining = cutoff - depth;
+    int hash_origin = -1;
+    int hash_destination = -1;
+    if(ctx.table && remaining > 0) {
+        TranspositionTable::Entry entry;
+        if(ctx.table->probe(hash, entry)) {
+            hash_origin = entry.move_origin;
+            hash_destination = entry.move_destination;
+            //never cut at the root, it has to name a move
+            if(depth > 1 && entry.depth >= remaining) {
+                if(entry.bound == TranspositionTable::Bound::Exact) return entry.score;
+                if(entry.bound == TranspositionTable::Bound::Lower && entry.score >= beta) return entry.score;
+                if(entry.bound == TranspositionTable::Bound::Upper && entry.score <= alpha) return entry.score;
+            }
+        }
+    }
+
+    std::vector<Move> moves = this->gen_filtered_children_moves<T>();
+    if(moves.size() == 0) {
         //checkmate condition
-        if(team == Team::Alpha) return -20000 * depth_score;
+        if constexpr(T == Team::Alpha) return -20000 * depth_score;
         else return 20000 * depth_score;
     }
-    if(depth == DEPTH_CUTOFF) return this->heuristic(team) * depth_score;
+    if(depth >= cutoff) return this->heuristic(T) * depth_score;
 
 
     int filter_num = EARLY_MOVE_BREADTH;
 
     int max_evaluations = 0;
     if(depth > LATE_MOVE_THRESHOLD) filter_num = LATE_MOVE_BREADTH;
-    if(depth > 2 && filter_num < children.size()) max_evaluations = filter_num;
-    else max_evaluations = children.size();
-
+    if(depth > 2 && filter_num < moves.size()) max_evaluations = filter_num;
+    else max_evaluations = moves.size();
+
+
+    std::vector<ChessBoard> children;
+    std::vector<int> order;
+    std::vector<int> exchange;
+    {
+        ALLOC_SITE(AllocSite::Ordering);
+        children.reserve(moves.size());
+        order.resize(moves.size());
+        exchange.resize(moves.size());
+        for(int i = 0; i < moves.size(); i++) {
+            PERF_SCOPE(PerfPhase::Ordering);
+            children.push_back(*this);
+            children[i].do_move(moves[i]);
+            children[i].heuristic(T);
+            order[i] = i;
+        }
 
-    for(int i = 0; i < children.size(); i++) {
-        children[i].heuristic(team);
-    }
+        if constexpr(T == Team::Alpha) {
+            std::sort(order.begin(), order.end(), [&children](int a, int b){
+                return children[a].stored_heuristic.value() > children[b].stored_heuristic.value();
+            });
+        }
+        else {
+            std::sort(order.begin(), order.end(), [&children](int a, int b){
+                return children[a].stored_heuristic.value() < children[b].stored_heuristic.value();
+            });
+        }
 
-    int strongest = 0;
-    if(team == Team::Alpha) {
-        strongest = INT_MIN;
-        std::sort(children.begin(), children.end(), [](ChessBoard a, ChessBoard b){
-            int a_heuristic = a.stored_heuristic.value();
-            int b_heuristic = b.stored_heuristic.value();
-            return a_heuristic > b_heuristic;
-        });
-    }
-    else {
-        strongest = INT_MAX;
-        std::sort(children.begin(), children.end(), [](ChessBoard a, ChessBoard b){
-            int a_heuristic = a.stored_heuristic.value();
-            int b_heuristic = b.stored_heuristic.value();
-            return a_heuristic < b_heuristic;
+        //captures that lose material in the exchange go after everything else, still in heuristic order
+        for(int i = 0; i < moves.size(); i++) {
+            if(this->at(moves[i].destination).has_value()) exchange[i] = this->see(moves[i]);
+        }
+        std::stable_partition(order.begin(), order.end(), [&exchange](int i){
+            return exchange[i] >= 0;
         });
-    }
 
+        //the hash move goes first
+        if(hash_origin >= 0) {
+            for(int i = 0; i < order.size(); i++) {
+                const Move &m = moves[order[i]];
+                if(m.origin.x() + m.origin.y()*8 == hash_origin && m.destination.x() + m.destination.y()*8 == hash_destination) {
+                    std::rotate(order.begin(), order.begin() + i, order.begin() + i + 1);
+                    break;
+                }
+            }
+        }
+    }
 
+    int strongest = T == Team::Alpha ? INT_MIN : INT_MAX;
+    std::optional<bool> in_check;
+    int alpha_original = alpha;
+    int beta_original = beta;
+    int best = order[0];
+    ctx.history.push_back(hash);
     for(int i = 0; i < max_evaluations; i++) {
-        int child_score = children[i].alpha_beta(depth+1, team_inverse(team), alpha, beta);
-        if(team == Team::Alpha) {
-            if(strongest < child_score) strongest = child_score;
+        ChessBoard &child = children[order[i]];
+        //near the leaves a losing capture is skipped unless it is part of a check sequence
+        if(i > 0 && depth > 1 && remaining <= SEE_PRUNE_DEPTH && exchange[order[i]] < 0) {
+            if(!in_check) in_check = this->get_check<T>();
+            if(!*in_check && !child.get_check<opponent>()) continue;
+        }
+        int child_score;
+        if(depth == 1 && ctx.multipv > 1) {
+            //the window only excludes moves that cannot reach the top multipv, so those that do get exact scores
+            bool full = ctx.root_scores.size() >= static_cast<size_t>(ctx.multipv);
+            if constexpr(T == Team::Alpha) {
+                int floor = full ? ctx.root_scores.back().second : INT_MIN;
+                child_score = full ? child.alpha_beta<opponent>(ctx, depth+1, cutoff, floor, floor+1) : INT_MAX;
+                if(child_score > floor) child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, floor, INT_MAX);
+                if(!ctx.aborted && (!full || child_score > floor)) {
+                    auto position = std::find_if(ctx.root_scores.begin(), ctx.root_scores.end(), [child_score](const std::pair<Move, int> &line){
+                        return line.second < child_score;
+                    });
+                    ctx.root_scores.insert(position, {moves[order[i]], child_score});
+                }
+            }
+            else {
+                int ceiling = full ? ctx.root_scores.back().second : INT_MAX;
+                child_score = full ? child.alpha_beta<opponent>(ctx, depth+1, cutoff, ceiling-1, ceiling) : INT_MIN;
+                if(child_score < ceiling) child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, INT_MIN, ceiling);
+                if(!ctx.aborted && (!full || child_score < ceiling)) {
+                    auto position = std::find_if(ctx.root_scores.begin(), ctx.root_scores.end(), [child_score](const std::pair<Move, int> &line){
+                        return line.second > child_score;
+                    });
+                    ctx.root_scores.insert(position, {moves[order[i]], child_score});
+                }
+            }
+            if(ctx.root_scores.size() > static_cast<size_t>(ctx.multipv)) ctx.root_scores.pop_back();
+        }
+        else if(i == 0) {
+            child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, alpha, beta);
+        }
+        else if constexpr(T == Team::Alpha) {
+            //null window: only prove that this move is no better than the best so far
+            child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, alpha, alpha+1);
+            if(child_score > alpha && child_score < beta) {
+                child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, alpha, beta);
+            }
+        }
+        else {
+            child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, beta-1, beta);
+            if(child_score < beta && child_score > alpha) {
+                child_score = child.alpha_beta<opponent>(ctx, depth+1, cutoff, alpha, beta);
+            }
+        }
+        if(ctx.aborted) break;
+        if constexpr(T == Team::Alpha) {
+            if(strongest < child_score) {
+                strongest = child_score;
+                best = order[i];
+            }
             if(alpha < child_score) alpha = child_score;
         }
-        if(team == Team::Beta){
-            if(strongest > child_score) strongest = child_score;
+        else {
+            if(strongest > child_score) {
+                strongest = child_score;
+                best = order[i];
+            }
             if(beta > child_score) beta = child_score;
         }
-        if(alpha > beta) break;
+        if(alpha >= beta) break;
+    }
+    ctx.history.pop_back();
+    if(ctx.aborted) return 0;
+
+    if(depth == 1) ctx.root_best = moves[best];
+    if(ctx.table) {
+        TranspositionTable::Entry entry;
+        entry.score = strongest;
+        entry.depth = remaining;
+        if(strongest <= alpha_original) entry.bound = TranspositionTable::Bound::Upper;
+        else if(strongest >= beta_original) entry.bound = TranspositionTable::Bound::Lower;
+        else entry.bound = TranspositionTable::Bound::Exact;
+        entry.move_origin = moves[best].origin.x() + moves[best].origin.y()*8;
+        entry.move_destination = moves[best].destination.x() + moves[best].destination.y()*8;
+        ctx.table->store(hash, entry);
     }
     return strongest;
 }
@@ -836,33 +1659,36 @@ std::pair<bool, int> ChessBoard::get_cod(Team t) {
 }
 
 int Piece::value() {
-    int piece_value = 1;
-    switch(this->rank) {
-    case Rank::Pawn:
-        piece_value = 1;
-        break;
-    case Rank::Knight:
-        piece_value = 3;
-        break;
-    case Rank::Bishop:
-        piece_value = 4;
-        break;
-    case Rank::Rook:
-        piece_value = 5;
-        break;
-    case Rank::Queen:
-        piece_value = 9;
-        break;
-    case Rank::King:
-        piece_value = 1;
-        break;
-    }
+    static const EvalParams defaults;
+    int piece_value = defaults.attack_value(this->rank);
     if(this->team == Team::Beta) {
         piece_value *= -1;
     }
     return piece_value;
 }
 
+//default material weights must leave the pst.h material baked into the accumulators unchanged
+static constexpr bool default_material_matches_pst() {
+    constexpr EvalParams defaults;
+    for(int rank = Rank::Pawn; rank < Rank::King; rank++) {
+        if(defaults.weights[EvalParams::PawnMaterialMg + rank] != MG_VALUE[rank]) return false;
+        if(defaults.weights[EvalParams::PawnMaterialEg + rank] != EG_VALUE[rank]) return false;
+    }
+    return true;
+}
+static_assert(default_material_matches_pst(), "EvalParams material defaults out of sync with pst.h");
+
+const char * EvalParams::name(int index) {
+    static const char * names[Count] = {
+        "material", "attack_defend", "check",
+        "pawn_attack", "knight_attack", "bishop_attack", "rook_attack", "queen_attack", "king_attack",
+        "doubled_pawn", "isolated_pawn", "passed_pawn", "king_shelter",
+        "pawn_mg", "knight_mg", "bishop_mg", "rook_mg", "queen_mg",
+        "pawn_eg", "knight_eg", "bishop_eg", "rook_eg", "queen_eg"
+    };
+    return index >= 0 && index < Count ? names[index] : "";
+}
+
 int ChessBoard::get_defense(Team t) {
     std::vector<Move> all_moves = gen_all_children_moves(t);
     int defense_sum = 0;
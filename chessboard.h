@@ -2,6 +2,11 @@
 #define CHESSBOARD_H
 
 #include <QPoint>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 #include <optional>
 #include <climits>
@@ -9,6 +14,9 @@
 
 #define BRANCHING_FACTOR 35
 //#define MATERIAL_ONLY
+//#define ASPIRATION_WINDOWS //iterate up to DEPTH_CUTOFF with windows around the previous score
+//#define PERF_COUNTERS //per-phase cycle and hardware counter totals, dumped after each search, see perfcounters.h
+//#define ALLOC_TRACKING //heap allocations per search and call site, dumped after each search, see allocationstats.h
 
 enum Team {
     Alpha,
@@ -24,8 +32,8 @@ enum Rank {
 };
 
 struct Piece {
-    Piece();
-    Piece(Team t, Rank r);
+    constexpr Piece() : team(Team::Alpha), rank(Rank::Pawn) {}
+    constexpr Piece(Team t, Rank r) : team(t), rank(r) {}
     Team team;
     Rank rank;
     constexpr bool operator==(Piece p) {return p.team == this->team && p.rank == this->rank;}
@@ -40,6 +48,86 @@ struct Move {
         return m.destination == this->destination && m.origin == this->origin && m.piece == this->piece;
     }
 };
+
+//evaluation weights as a flat runtime vector so they can be tuned, see texeltuner.h
+struct EvalParams {
+    enum Index {
+        MaterialCoefficient,//per pawn of tapered material
+        AttackDefendCoefficient,
+        CheckCoefficient,
+        PawnAttackValue,//weight of each attacked or defended piece in the attack/defend term, Rank order, see Piece::value()
+        KnightAttackValue,
+        BishopAttackValue,
+        RookAttackValue,
+        QueenAttackValue,
+        KingAttackValue,
+        DoubledPawn,//centipawns, see PawnStructure
+        IsolatedPawn,
+        PassedPawn,//per rank advanced, half of it in the middlegame
+        KingShelter,//middlegame only
+        PawnMaterialMg,//tapered material in centipawns, Rank order without the king, defaults are MG_VALUE and EG_VALUE in pst.h
+        KnightMaterialMg,
+        BishopMaterialMg,
+        RookMaterialMg,
+        QueenMaterialMg,
+        PawnMaterialEg,
+        KnightMaterialEg,
+        BishopMaterialEg,
+        RookMaterialEg,
+        QueenMaterialEg,
+        Count
+    };
+    int weights[Count] = {1000, 25, 2000, 1, 3, 4, 5, 9, 1, 15, 10, 8, 8, 100, 300, 400, 500, 900, 120, 280, 380, 520, 920};
+    int attack_value(Rank r) const {return weights[PawnAttackValue + r];}
+    static const char * name(int index);
+};
+
+class TranspositionTable;
+struct PawnStructure;
+
+struct SearchLimits {
+    int depth = 0;//plies, 0 searches to DEPTH_CUTOFF
+    int64_t nodes = 0;//0 for no limit
+    int64_t movetime = 0;//milliseconds, 0 for no limit
+    int multipv = 1;//root moves to report with exact scores
+    //game clock of the side to move in milliseconds, see TimeManager; 0 time_left for no clock
+    int64_t time_left = 0;
+    int64_t increment = 0;
+    int moves_to_go = 0;//until the next time control, 0 for the rest of the game
+};
+
+struct PrincipalVariation {
+    Move move;
+    int score = 0;
+    std::vector<Move> line;//starts with move, continued from the transposition table
+};
+
+struct SearchResult {
+    std::optional<Move> best_move;
+    int score = 0;//Alpha positive, see ChessBoard::centipawns()
+    int depth = 0;//last completed iteration
+    int64_t nodes = 0;
+    int64_t time = 0;//milliseconds
+    int64_t allocations = 0;//heap allocations made by the search, only counted with ALLOC_TRACKING
+    int64_t allocated_bytes = 0;
+    std::vector<PrincipalVariation> lines;//best first, up to SearchLimits::multipv
+};
+
+//state threaded through one search
+struct SearchContext {
+    TranspositionTable * table = nullptr;
+    const std::atomic<bool> * stop = nullptr;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    int64_t node_limit = 0;
+    int64_t nodes = 0;
+    bool aborted = false;
+    std::optional<Move> root_best;
+    int multipv = 1;
+    std::vector<std::pair<Move, int>> root_scores;//exact scores of the best root moves when multipv > 1, best first
+    std::vector<uint64_t> history;//keys of the game's earlier positions, then the search path, parent last
+    bool should_stop();
+};
+
 enum class Check {
     Beta_Mate = -2,
     Beta_Check = -1,
@@ -70,33 +158,65 @@ public:
     bool do_move(Move m);//occurs at end of animation
     std::optional<Piece>& at(QPoint index);
     std::optional<Piece>& at(int x, int y);
+    void place(QPoint index, std::optional<Piece> piece);//keeps the incremental evaluation in sync, use it rather than writing through at()
+    uint64_t key(Team to_move);
+    int get_halfmove_clock();
     static bool in_bounds(QPoint p);
     int alpha_beta(Team team);
     int alpha_beta(int depth, Team team, int alpha, int beta);
+    int alpha_beta(int depth, int cutoff, Team team, int alpha, int beta);
+    SearchResult search(Team team, const SearchLimits &limits, TranspositionTable * table = nullptr,
+                        const std::atomic<bool> * stop = nullptr,
+                        const std::function<void(const SearchResult &)> &on_iteration = {},
+                        const std::vector<uint64_t> &history = {});//keys of the positions played before this one, oldest first
+    std::optional<int> rule_draw_score(Team to_move, const std::vector<uint64_t> &history);//DRAW_SCORE if the fifty-move rule or a repeat of history (oldest first) already draws here
+    //search() leaves the table's generation alone, call TranspositionTable::new_search() once per move played
     bool valid_move(Move m);
     bool legal_move(Move m);
     bool get_check(Team t);
     bool operator==(ChessBoard q1);
+    std::vector<Move> gen_all_children_moves(Team t);//pseudo-legal, own king may be left in check
     std::vector<ChessBoard> gen_filtered_children_boards(Team t);
     std::vector<Move> gen_filtered_children_moves(Team t);
 
     int heuristic(Team t);
+    int heuristic(Team t, const EvalParams &params);//Alpha positive whichever side t is to move
+    int see(Move m);//static exchange on m's destination, centipawns won by the mover, negative if the exchange loses material
+    static int centipawns(int score);
+
+    static std::optional<ChessBoard> from_fen(const std::string &fen, Team * to_move = nullptr);
+    std::string to_fen(Team to_move);
+    static std::string move_to_string(Move m);//coordinate notation, e.g. e2e4
+    std::optional<Move> parse_move(const std::string &text, Team team);
 
 private:
     static constexpr const int diagonals[4][2] = {{1,1},{1,-1},{-1,-1},{-1,1}};
     static constexpr const int cardinals[4][2] = {{0,1},{1,0},{0,-1},{-1,0}};
     std::optional<Piece> board[8][8];
     std::optional<int> stored_heuristic;
+    //piece-square sums (material included) and game phase, maintained by place()
+    int psq_mg;
+    int psq_eg;
+    int phase;
+    uint64_t zobrist;//pieces only, see key()
+    uint64_t pawn_zobrist;//pawns and kings only, see pawn_structure()
     std::vector<ChessBoard> children;
 
-    static const int MATERIAL_COEFFICIENT = 1000;
-    static const int ATTACK_DEFEND_COEFFICIENT = 25;
-    static const int CHECK_COEFFICIENT = 2000;
+    static const int MATERIAL_COEFFICIENT = 1000;//score scale per pawn, the default EvalParams material weight
     static const int DEPTH_BONUS = 10;
     static const int EARLY_MOVE_BREADTH = 4;
     static const int LATE_MOVE_THRESHOLD = 4;
     static const int LATE_MOVE_BREADTH = 2;
     static const int DEPTH_CUTOFF = 10;
+    static const int MAX_TIMED_DEPTH = 30;//a clock decides when to stop rather than DEPTH_CUTOFF
+    static const int ITERATION_STEP = 2;//deepen two plies at a time so the leaves keep the same side to move
+    static const int ASPIRATION_MIN_DEPTH = 4;
+    static const int ASPIRATION_WINDOW = 10000;//one pawn at leaf scale
+    static const int ASPIRATION_LIMIT = 100000;//past this the window opens fully
+    static const int FIFTY_MOVE_PLIES = 100;
+    static const int DRAW_SCORE = 0;
+    static const int SEE_KING_VALUE = 20000;//a king only captures when nothing can take it back
+    static const int SEE_PRUNE_DEPTH = 2;//plies left at or below which losing captures are skipped
 
     static const int CASTLE_BETA_LEFT = 1;
     static const int CASTLE_BETA_RIGHT = 2;
@@ -104,20 +224,45 @@ private:
     static const int CASTLE_ALPHA_RIGHT = 8;
 
     char castle_status;
+    int halfmove_clock;//plies since the last capture or pawn move
 
     std::vector<ChessBoard> gen_all_children_boards(Team t);
-    std::vector<Move> gen_all_children_moves(Team t);
     std::vector<ChessBoard> gen_diagonal_boards(QPoint origin, bool extending);
     std::vector<Move> gen_diagonal_moves(QPoint origin, bool extending);
     std::vector<ChessBoard> gen_cardinal_boards(QPoint origin, bool extending);
     std::vector<Move> gen_cardinal_moves(QPoint origin, bool extending);
     std::vector<ChessBoard> gen_pawn_boards(QPoint origin);
-    std::vector<Move> gen_pawn_moves(QPoint origin);
+    template<Team T> std::vector<Move> gen_pawn_moves(QPoint origin);
     std::vector<ChessBoard> gen_knight_boards(QPoint origin);
     std::vector<Move> gen_knight_moves(QPoint origin);
     std::vector<ChessBoard> gen_best_boards(Team t, int limit);
 
+    //side to move as a template parameter, so pawn directions and castle masks are constants
+    template<Team T> std::vector<Move> gen_all_children_moves();
+    template<Team T> std::vector<Move> gen_filtered_children_moves();
+    template<Team T> std::vector<ChessBoard> gen_filtered_children_boards();
+    template<Team T> bool get_check();
+    template<Team T> void accumulate_attacks(int32_t AD_map[64], int &check_sum);
+    template<Team T> int alpha_beta(SearchContext &ctx, int depth, int cutoff, int alpha, int beta);
+    int alpha_beta(SearchContext &ctx, int depth, int cutoff, Team team, int alpha, int beta);
+    int search_iteration(SearchContext &ctx, int cutoff, Team team, int previous_score);
+    std::vector<Move> hash_line(TranspositionTable * table, Team team, Move first, int length);
+    PawnStructure pawn_structure();
+    int least_valuable_attacker(int square, Team side, uint64_t occupied);
+
+    //bit x + y*8 per square
+    struct LegalMasks {
+        int king;
+        uint64_t attacked;//by the opponent, looking through our king
+        uint64_t check_mask;//destinations that resolve check, all squares if not in check
+        int pin_count;
+        int pinned[8];
+        uint64_t pin_ray[8];//squares the pinned piece may move to
+    };
+    template<Team T> LegalMasks gen_legal_masks();
+
     bool square_attacked(std::vector<Move> &moves, QPoint square);
+    void refresh_accumulators();
 
 
     bool dead_king(Team t);
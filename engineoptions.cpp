@@ -0,0 +1,52 @@
+#include "engineoptions.h"
+
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+int EngineOptions::thread_count() const {
+    return threads > 0 ? threads : std::max(1, QThread::idealThreadCount());
+}
+
+bool parse_cpu_list(const QString &text, std::vector<int> &cpus) {
+    cpus.clear();
+    for(const QString &part : text.split(',', Qt::SkipEmptyParts)) {
+        QStringList range = part.trimmed().split('-');
+        bool first_ok = false, last_ok = false;
+        int first = range[0].toInt(&first_ok);
+        int last = range.size() == 2 ? range[1].toInt(&last_ok) : first;
+        if(range.size() == 1) last_ok = first_ok;
+        if(range.size() > 2 || !first_ok || !last_ok || first < 0 || last < first) return false;
+        for(int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return !cpus.empty();
+}
+
+bool pin_engine_thread(const std::vector<int> &cpus) {
+    if(cpus.empty()) return false;
+    //threads are pool workers that get reused, so each pins itself once
+    static std::atomic<int> next_slot{0};
+    thread_local int pinned_cpu = -1;
+    if(pinned_cpu >= 0 && std::find(cpus.begin(), cpus.end(), pinned_cpu) != cpus.end()) return true;
+    int cpu = cpus[next_slot.fetch_add(1, std::memory_order_relaxed) % cpus.size()];
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) return false;
+#elif defined(_WIN32)
+    if(cpu >= 64 || SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) == 0) return false;
+#else
+    return false;
+#endif
+    pinned_cpu = cpu;
+    return true;
+}
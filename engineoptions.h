@@ -0,0 +1,30 @@
+#ifndef ENGINEOPTIONS_H
+#define ENGINEOPTIONS_H
+
+#include <QString>
+#include <cstddef>
+#include <vector>
+
+/*
+    Resources the engine may use: how many search threads, how much memory
+    for the transposition table and, optionally, which cores its threads
+    are kept on. Pinning is applied by each search thread to itself the
+    first time it runs engine work, spreading threads over the listed cores.
+*/
+
+struct EngineOptions {
+    int threads = 0;//0 for one per core
+    size_t hash_megabytes = 32;
+    QString hash_file;//empty keeps the table in memory
+    std::vector<int> cpus;//empty leaves scheduling to the OS
+
+    int thread_count() const;
+};
+
+//parses "0-3,6" style lists, false on anything malformed
+bool parse_cpu_list(const QString &text, std::vector<int> &cpus);
+
+//pins the calling thread to one of cpus, each new thread taking the next core; false if pinning is unsupported or failed
+bool pin_engine_thread(const std::vector<int> &cpus);
+
+#endif // ENGINEOPTIONS_H
@@ -0,0 +1,151 @@
+#include "evalkernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EVAL_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static int material_sum_scalar(const int32_t values[64]) {
+    int sum = 0;
+    for(int i = 0; i < 64; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+static int attack_defend_sum_scalar(const int32_t values[64], const int32_t ad_map[64]) {
+    int sum = 0;
+    for(int i = 0; i < 64; i++) {
+        if(ad_map[i] > 0) sum -= values[i];//if being attacked
+        if(ad_map[i] < 0) sum += values[i];//if being defended
+    }
+    return sum;
+}
+
+#ifdef EVAL_KERNELS_X86
+__attribute__((target("ssse3")))
+static int horizontal_sum_ssse3(__m128i v) {
+    v = _mm_hadd_epi32(v, v);
+    v = _mm_hadd_epi32(v, v);
+    return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("ssse3")))
+static int material_sum_ssse3(const int32_t values[64]) {
+    const __m128i * v = reinterpret_cast<const __m128i *>(values);
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < 16; i++) {
+        sum = _mm_add_epi32(sum, _mm_loadu_si128(v + i));
+    }
+    return horizontal_sum_ssse3(sum);
+}
+
+__attribute__((target("ssse3")))
+static int attack_defend_sum_ssse3(const int32_t values[64], const int32_t ad_map[64]) {
+    const __m128i * v = reinterpret_cast<const __m128i *>(values);
+    const __m128i * ad = reinterpret_cast<const __m128i *>(ad_map);
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < 16; i++) {
+        //value * sign(ad), zero where the square is neither attacked nor defended
+        sum = _mm_add_epi32(sum, _mm_sign_epi32(_mm_loadu_si128(v + i), _mm_loadu_si128(ad + i)));
+    }
+    return -horizontal_sum_ssse3(sum);
+}
+
+__attribute__((target("avx2")))
+static int horizontal_sum_avx2(__m256i v) {
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    half = _mm_hadd_epi32(half, half);
+    half = _mm_hadd_epi32(half, half);
+    return _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("avx2")))
+static int material_sum_avx2(const int32_t values[64]) {
+    const __m256i * v = reinterpret_cast<const __m256i *>(values);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < 8; i++) {
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256(v + i));
+    }
+    return horizontal_sum_avx2(sum);
+}
+
+__attribute__((target("avx2")))
+static int attack_defend_sum_avx2(const int32_t values[64], const int32_t ad_map[64]) {
+    const __m256i * v = reinterpret_cast<const __m256i *>(values);
+    const __m256i * ad = reinterpret_cast<const __m256i *>(ad_map);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < 8; i++) {
+        sum = _mm256_add_epi32(sum, _mm256_sign_epi32(_mm256_loadu_si256(v + i), _mm256_loadu_si256(ad + i)));
+    }
+    return -horizontal_sum_avx2(sum);
+}
+#endif
+
+struct EvalKernels {
+    EvalIsa isa;
+    int (*material_sum)(const int32_t *);
+    int (*attack_defend_sum)(const int32_t *, const int32_t *);
+};
+
+static EvalKernels kernels_for(EvalIsa isa) {
+    switch(isa) {
+#ifdef EVAL_KERNELS_X86
+    case EvalIsa::AVX2:
+        return EvalKernels{EvalIsa::AVX2, material_sum_avx2, attack_defend_sum_avx2};
+    case EvalIsa::SSSE3:
+        return EvalKernels{EvalIsa::SSSE3, material_sum_ssse3, attack_defend_sum_ssse3};
+#endif
+    default:
+        return EvalKernels{EvalIsa::Scalar, material_sum_scalar, attack_defend_sum_scalar};
+    }
+}
+
+static EvalKernels & active_kernels() {
+    static EvalKernels kernels = kernels_for(eval_isa_supported(EvalIsa::AVX2) ? EvalIsa::AVX2 :
+                                             eval_isa_supported(EvalIsa::SSSE3) ? EvalIsa::SSSE3 : EvalIsa::Scalar);
+    return kernels;
+}
+
+int eval_material_sum(const int32_t values[64]) {
+    return active_kernels().material_sum(values);
+}
+
+int eval_attack_defend_sum(const int32_t values[64], const int32_t ad_map[64]) {
+    return active_kernels().attack_defend_sum(values, ad_map);
+}
+
+EvalIsa eval_isa() {
+    return active_kernels().isa;
+}
+
+bool eval_isa_supported(EvalIsa isa) {
+    switch(isa) {
+#ifdef EVAL_KERNELS_X86
+    case EvalIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case EvalIsa::SSSE3:
+        return __builtin_cpu_supports("ssse3");
+#endif
+    case EvalIsa::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void eval_set_isa(EvalIsa isa) {
+    if(!eval_isa_supported(isa)) return;
+    active_kernels() = kernels_for(isa);
+}
+
+const char * eval_isa_name(EvalIsa isa) {
+    switch(isa) {
+    case EvalIsa::AVX2:
+        return "avx2";
+    case EvalIsa::SSSE3:
+        return "ssse3";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef EVALKERNELS_H
+#define EVALKERNELS_H
+
+#include <cstdint>
+
+/*
+    Reductions over the 64 squares used by ChessBoard::heuristic().
+    Boards are laid out flat, one int32 per square at x + y*8, with
+    piece values already signed by team (see Piece::value()).
+
+    The SSSE3/AVX2 paths are picked once at runtime from what the CPU
+    reports, everything else falls back to the scalar loops.
+*/
+
+enum class EvalIsa {
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+//sum of all square values
+int eval_material_sum(const int32_t values[64]);
+//pieces under attack (positive count) lose their value, defended pieces (negative count) gain it
+int eval_attack_defend_sum(const int32_t values[64], const int32_t ad_map[64]);
+
+EvalIsa eval_isa();
+bool eval_isa_supported(EvalIsa isa);
+void eval_set_isa(EvalIsa isa);//for benchmarking, ignored if unsupported
+const char * eval_isa_name(EvalIsa isa);
+
+#endif // EVALKERNELS_H
@@ -1,11 +1,34 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <algorithm>
+#include <cstdio>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption threads_option("threads", "Engine search threads, 0 for one per core.", "count", "0");
+    QCommandLineOption hash_option("hash", "Engine transposition table size.", "MB", "32");
+    QCommandLineOption hash_file_option("hash-file", "Keep the engine's transposition table in <file> between runs.", "file");
+    QCommandLineOption cpus_option("cpus", "Keep the engine's threads on these cores, e.g. 2-5,7.", "list");
+    parser.addOptions({threads_option, hash_option, hash_file_option, cpus_option});
+    parser.process(a);
+
+    EngineOptions options;
+    options.threads = std::max(0, parser.value(threads_option).toInt());
+    options.hash_megabytes = std::max(1, parser.value(hash_option).toInt());
+    options.hash_file = parser.value(hash_file_option);
+    if(parser.isSet(cpus_option) && !parse_cpu_list(parser.value(cpus_option), options.cpus)) {
+        fprintf(stderr, "--cpus expects a list like 0-3,6\n");
+        return 1;
+    }
+
     MainWindow w;
+    w.set_engine_options(options);
     w.show();
     return a.exec();
 }
@@ -18,6 +18,9 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::set_engine_options(const EngineOptions &options) {
+    this->ui->frame->set_engine_options(options);
+}
 
 void MainWindow::on_pushButton_clicked()
 {
@@ -42,8 +45,8 @@ void MainWindow::on_move_made(Team t) {
     }
 }
 
-void MainWindow::on_evaluation_updated(int value) {
-    int sigmoided_value = 200.0 / (1.0 + exp(-value/100.0)) - 100.0;
+void MainWindow::on_evaluation_updated(int centipawns) {
+    int sigmoided_value = 200.0 / (1.0 + exp(-centipawns/10.0)) - 100.0;
     this->ui->qualityBar->setValue(sigmoided_value);
     this->ui->qualityBar->update();
 }
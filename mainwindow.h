@@ -15,12 +15,13 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    void set_engine_options(const EngineOptions &options);
 
 private slots:
     void on_pushButton_clicked();
     void on_think_updated(float percent);
     void on_move_made(Team t);
-    void on_evaluation_updated(int value);
+    void on_evaluation_updated(int centipawns);
     void on_think_finished();
 private:
     Ui::MainWindow *ui;
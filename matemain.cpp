@@ -0,0 +1,107 @@
+#include "matesearch.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Puzzle {
+    QString fen;
+    int expected = 0;//from a "dm N;" opcode, 0 if not given
+    MateResult result;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("chess_mate");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Proves or refutes forced mates with a proof-number search");
+    parser.addHelpOption();
+    parser.addPositionalArgument("positions", "File with one FEN or EPD per line, optionally ending in \"dm N;\".");
+    QCommandLineOption moves_option("moves", "Longest mate looked for when a line gives no dm.", "moves", "5");
+    QCommandLineOption nodes_option("nodes", "Node budget per position, 0 for none.", "count", "0");
+    QCommandLineOption hash_option("hash", "Proof table size per thread.", "MB", "64");
+    QCommandLineOption threads_option("threads", "Positions solved at once.", "count", QString::number(QThread::idealThreadCount()));
+    parser.addOptions({moves_option, nodes_option, hash_option, threads_option});
+    parser.process(a);
+    if(parser.positionalArguments().size() != 1) parser.showHelp(1);
+
+    QFile file(parser.positionalArguments().first());
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        fprintf(stderr, "could not open %s\n", qPrintable(file.fileName()));
+        return 1;
+    }
+    std::vector<Puzzle> puzzles;
+    while(!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if(line.isEmpty() || line.startsWith('#')) continue;
+        Puzzle puzzle;
+        int opcode = line.indexOf(" dm ");
+        if(opcode >= 0) {
+            puzzle.expected = line.mid(opcode + 4).remove(';').trimmed().toInt();
+            line = line.left(opcode);
+        }
+        puzzle.fen = line;
+        puzzles.push_back(puzzle);
+    }
+
+    int max_moves = std::max(1, parser.value(moves_option).toInt());
+    int64_t node_limit = parser.value(nodes_option).toLongLong();
+    size_t hash_megabytes = std::max(1, parser.value(hash_option).toInt());
+    std::atomic<int> invalid(0);
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, parser.value(threads_option).toInt()));
+    for(Puzzle &puzzle : puzzles) {
+        pool.start([&puzzle, &invalid, max_moves, node_limit, hash_megabytes]{
+            //one table per worker, kept between its positions
+            thread_local std::unique_ptr<MateSearch> search;
+            if(!search) search = std::make_unique<MateSearch>(hash_megabytes);
+            Team to_move;
+            std::optional<ChessBoard> board = ChessBoard::from_fen(puzzle.fen.toStdString(), &to_move);
+            if(!board) {
+                invalid++;
+                return;
+            }
+            search->clear();
+            puzzle.result = search->solve(*board, to_move, puzzle.expected > 0 ? puzzle.expected : max_moves, node_limit);
+        });
+    }
+    pool.waitForDone();
+
+    int mates = 0;
+    int mismatches = 0;
+    int64_t nodes = 0;
+    for(const Puzzle &puzzle : puzzles) {
+        const MateResult &result = puzzle.result;
+        nodes += result.nodes;
+        std::string verdict;
+        if(result.status == MateResult::Status::Mate) {
+            mates++;
+            verdict = "mate " + std::to_string(result.moves);
+            for(size_t i = 0; i < result.line.size(); i++) verdict += (i == 0 ? "\t" : " ") + ChessBoard::move_to_string(result.line[i]);
+        }
+        else if(result.status == MateResult::Status::NoMate) verdict = "no mate";
+        else verdict = "unknown";
+        //a puzzle with a dm opcode has to be a mate of exactly that length, not a shorter one
+        bool mismatch = puzzle.expected > 0 && (result.status != MateResult::Status::Mate || result.moves != puzzle.expected);
+        if(mismatch) mismatches++;
+        printf("%s%s\t%s\n", mismatch ? "MISMATCH\t" : "", qPrintable(puzzle.fen), verdict.c_str());
+    }
+    double seconds = std::max<qint64>(timer.elapsed(), 1) / 1000.0;
+    printf("%zu positions, %d mates, %d mismatches, %d invalid, %lld nodes in %.2f s\n", puzzles.size(), mates, mismatches,
+           invalid.load(), static_cast<long long>(nodes), seconds);
+    return mismatches > 0 || invalid > 0 ? 1 : 0;
+}
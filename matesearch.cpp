@@ -0,0 +1,166 @@
+#include "matesearch.h"
+
+#include <algorithm>
+
+MateSearch::MateSearch(size_t megabytes) {
+    size_t count = 1;
+    while(count * 2 * sizeof(Entry) <= std::max<size_t>(megabytes, 1) * 1024 * 1024) count *= 2;
+    entries = std::make_unique<Entry[]>(count);
+    mask = count - 1;
+    clear();
+}
+
+void MateSearch::clear() {
+    for(size_t i = 0; i <= mask; i++) {
+        entries[i] = Entry{0, 0, 0, 0};
+    }
+}
+
+uint64_t MateSearch::node_key(ChessBoard &board, Team to_move, int plies_left) {
+    return board.key(to_move) ^ (static_cast<uint64_t>(plies_left + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+bool MateSearch::lookup(uint64_t key, Numbers &numbers, uint32_t * work) {
+    const Entry &entry = entries[key & mask];
+    if(entry.key != key || entry.work == 0) {
+        numbers = Numbers{1, 1};
+        if(work) *work = 0;
+        return false;
+    }
+    numbers = Numbers{entry.phi, entry.delta};
+    if(work) *work = entry.work;
+    return true;
+}
+
+void MateSearch::store(uint64_t key, Numbers numbers, uint32_t work) {
+    Entry &entry = entries[key & mask];
+    if(entry.key != key && entry.work > work) return;
+    entry = Entry{key, numbers.phi, numbers.delta, std::max<uint32_t>(work, 1)};
+}
+
+//a node whose outcome needs no search: mate, stalemate, or the attacker out of plies
+bool MateSearch::terminal(ChessBoard &board, Team to_move, int plies_left, bool has_moves, Numbers &numbers) {
+    bool attacking = to_move == attacker;
+    if(!has_moves && board.get_check(to_move)) {
+        numbers = Numbers{INFINITE, 0};//the side to move is mated
+        return true;
+    }
+    if(!has_moves || plies_left == 0) {
+        //stalemate, or no plies left without a mate, both count as an escape
+        numbers = attacking ? Numbers{INFINITE, 0} : Numbers{0, INFINITE};
+        return true;
+    }
+    return false;
+}
+
+//the side to move wins its goal once some child is lost for the opponent (phi = min child delta)
+//and loses it once every child is won for the opponent (delta = sum of child phi)
+MateSearch::Numbers MateSearch::expand(ChessBoard &board, Team to_move, int plies_left, uint32_t phi_threshold, uint32_t delta_threshold) {
+    uint64_t key = node_key(board, to_move, plies_left);
+    nodes++;
+    if((node_limit > 0 && nodes >= node_limit) || (stop && (nodes & 1023) == 0 && stop->load(std::memory_order_relaxed))) aborted = true;
+
+    std::vector<Move> moves = board.gen_filtered_children_moves(to_move);
+    Numbers numbers;
+    if(terminal(board, to_move, plies_left, !moves.empty(), numbers)) {
+        store(key, numbers, 1);
+        return numbers;
+    }
+
+    Team opponent = team_inverse(to_move);
+    std::vector<ChessBoard> children(moves.size(), board);
+    std::vector<uint64_t> keys(moves.size());
+    std::vector<Numbers> child_numbers(moves.size());
+    for(size_t i = 0; i < moves.size(); i++) {
+        children[i].do_move(moves[i]);
+        keys[i] = node_key(children[i], opponent, plies_left - 1);
+        lookup(keys[i], child_numbers[i]);
+    }
+
+    int64_t start_nodes = nodes;
+    while(true) {
+        size_t best = 0;
+        uint32_t second_delta = INFINITE;
+        uint64_t phi_sum = 0;
+        for(size_t i = 0; i < moves.size(); i++) {
+            phi_sum += child_numbers[i].phi;
+            if(i == 0) continue;
+            if(child_numbers[i].delta < child_numbers[best].delta) {
+                second_delta = child_numbers[best].delta;
+                best = i;
+            }
+            else second_delta = std::min(second_delta, child_numbers[i].delta);
+        }
+        if(moves.size() == 1) second_delta = INFINITE;
+        numbers.phi = child_numbers[best].delta;
+        numbers.delta = static_cast<uint32_t>(std::min<uint64_t>(phi_sum, INFINITE));
+        if(numbers.phi >= phi_threshold || numbers.delta >= delta_threshold || aborted) break;
+
+        //search the most promising child until it stops being the most promising
+        uint32_t child_phi_threshold = delta_threshold - numbers.delta + child_numbers[best].phi;
+        uint32_t child_delta_threshold = std::min(phi_threshold, second_delta + 1);
+        child_numbers[best] = expand(children[best], opponent, plies_left - 1, child_phi_threshold, child_delta_threshold);
+    }
+    store(key, numbers, static_cast<uint32_t>(std::min<int64_t>(nodes - start_nodes + 1, UINT32_MAX)));
+    return numbers;
+}
+
+//follows the proof from the table: a mating move for the attacker, the reply that took the most work to refute for the defender
+std::vector<Move> MateSearch::proof_line(ChessBoard board, int plies) {
+    std::vector<Move> line;
+    Team side = attacker;
+    for(int left = plies; left > 0; left--) {
+        std::optional<Move> chosen;
+        uint32_t chosen_work = 0;
+        for(Move m : board.gen_filtered_children_moves(side)) {
+            ChessBoard child = board;
+            child.do_move(m);
+            Numbers numbers;
+            uint32_t work;
+            if(!lookup(node_key(child, team_inverse(side), left - 1), numbers, &work)) continue;
+            if(side == attacker && numbers.delta == 0) {
+                chosen = m;
+                break;
+            }
+            if(side != attacker && numbers.phi == 0 && (!chosen || work > chosen_work)) {
+                chosen = m;
+                chosen_work = work;
+            }
+        }
+        if(!chosen) break;
+        line.push_back(*chosen);
+        board.do_move(*chosen);
+        side = team_inverse(side);
+    }
+    return line;
+}
+
+MateResult MateSearch::solve(const ChessBoard &board, Team attacker, int max_moves, int64_t node_limit,
+                             const std::atomic<bool> * stop) {
+    this->attacker = attacker;
+    this->node_limit = node_limit;
+    this->stop = stop;
+    nodes = 0;
+    aborted = false;
+
+    MateResult result;
+    result.status = MateResult::Status::NoMate;
+    ChessBoard position = board;
+    //the shortest mate first, proofs for shorter bounds are kept apart by the plies in the key
+    for(int moves = 1; moves <= max_moves; moves++) {
+        int plies = moves * 2 - 1;
+        Numbers numbers = expand(position, attacker, plies, INFINITE, INFINITE);
+        if(aborted) {
+            result.status = MateResult::Status::Unknown;
+            break;
+        }
+        if(numbers.phi == 0) {
+            result.status = MateResult::Status::Mate;
+            result.moves = moves;
+            result.line = proof_line(position, plies);
+            break;
+        }
+    }
+    result.nodes = nodes;
+    return result;
+}
@@ -0,0 +1,77 @@
+#ifndef MATESEARCH_H
+#define MATESEARCH_H
+
+#include "chessboard.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+    Depth-first proof-number search (df-pn) for forced mates. Instead of
+    scoring positions it counts how many leaves would still have to be
+    proven or disproven, and always expands the cheapest node to settle,
+    which finds narrow forcing lines far sooner than a full-width search.
+
+    The attacker has at most 2N-1 plies to deliver mate, so proofs depend
+    on the plies left as well as the position and both go into the table
+    key. The table has a fixed size; when slots collide the entry that
+    took more work to compute is kept.
+*/
+
+struct MateResult {
+    enum class Status {
+        Mate,//forced mate in moves
+        NoMate,//none within the bound
+        Unknown//stopped by the node limit or the stop flag
+    };
+    Status status = Status::Unknown;
+    int moves = 0;//attacker moves to mate, shortest found
+    std::vector<Move> line;//a mating line, best defence by proof work
+    int64_t nodes = 0;
+};
+
+class MateSearch
+{
+public:
+    explicit MateSearch(size_t megabytes);
+    //looks for a mate by the side to move in at most max_moves of its moves, the shortest first
+    MateResult solve(const ChessBoard &board, Team attacker, int max_moves, int64_t node_limit = 0,
+                     const std::atomic<bool> * stop = nullptr);
+    void clear();
+
+private:
+    //phi and delta are the proof and disproof numbers seen from the side to move:
+    //phi is the cost of proving it wins its goal (mate for the attacker, escape for the defender)
+    struct Entry {
+        uint64_t key;
+        uint32_t phi;
+        uint32_t delta;
+        uint32_t work;//nodes spent below this one
+    };
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+    Team attacker;
+    int64_t nodes;
+    int64_t node_limit;
+    const std::atomic<bool> * stop;
+    bool aborted;
+
+    struct Numbers {
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    static const uint32_t INFINITE = 100000000;
+
+    static uint64_t node_key(ChessBoard &board, Team to_move, int plies_left);
+    bool lookup(uint64_t key, Numbers &numbers, uint32_t * work = nullptr);//unknown nodes read as 1, 1
+    void store(uint64_t key, Numbers numbers, uint32_t work);
+    bool terminal(ChessBoard &board, Team to_move, int plies_left, bool has_moves, Numbers &numbers);
+    Numbers expand(ChessBoard &board, Team to_move, int plies_left, uint32_t phi_threshold, uint32_t delta_threshold);
+    std::vector<Move> proof_line(ChessBoard board, int plies);
+};
+
+#endif // MATESEARCH_H
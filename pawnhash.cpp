@@ -0,0 +1,28 @@
+#include "pawnhash.h"
+
+PawnHashTable::PawnHashTable(size_t entries) {
+    size_t count = 1;
+    while(count * 2 <= entries) count *= 2;
+    //zeroed, and a zero key would be a board without pawns or kings, so empty slots never match
+    this->entries = std::make_unique<Entry[]>(count);
+    mask = count - 1;
+    hit_count = 0;
+    miss_count = 0;
+}
+
+bool PawnHashTable::probe(uint64_t key, PawnStructure &structure) {
+    const Entry &entry = entries[key & mask];
+    if(entry.key != key) {
+        miss_count++;
+        return false;
+    }
+    hit_count++;
+    structure = entry.structure;
+    return true;
+}
+
+void PawnHashTable::store(uint64_t key, const PawnStructure &structure) {
+    Entry &entry = entries[key & mask];
+    entry.key = key;
+    entry.structure = structure;
+}
@@ -0,0 +1,49 @@
+#ifndef PAWNHASH_H
+#define PAWNHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+    Cache of pawn-structure terms keyed on a Zobrist key of the pawns and
+    kings only (king squares are in it for the shelter term). Most leaves
+    of a search share their pawn skeleton with many others, so the scan
+    behind these terms runs only on a miss.
+
+    Entries hold unweighted feature counts rather than scores so they stay
+    valid while the evaluation weights are tuned. Each search thread uses
+    its own table, see ChessBoard::pawn_structure().
+*/
+
+//Alpha's count minus Beta's
+struct PawnStructure {
+    int16_t doubled = 0;//pawns beyond the first on a file
+    int16_t isolated = 0;//no friendly pawn on a neighbouring file
+    int16_t passed = 0;//sum of ranks advanced by pawns no enemy pawn can stop
+    int16_t shelter = 0;//friendly pawns on the two ranks in front of the king, its file and the neighbouring ones
+};
+
+class PawnHashTable
+{
+public:
+    explicit PawnHashTable(size_t entries = DEFAULT_ENTRIES);
+    bool probe(uint64_t key, PawnStructure &structure);
+    void store(uint64_t key, const PawnStructure &structure);
+    int64_t hits() const {return hit_count;}
+    int64_t misses() const {return miss_count;}
+
+    static const size_t DEFAULT_ENTRIES = 1 << 14;
+
+private:
+    struct Entry {
+        uint64_t key;
+        PawnStructure structure;
+    };
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+    int64_t hit_count;
+    int64_t miss_count;
+};
+
+#endif // PAWNHASH_H
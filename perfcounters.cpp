@@ -0,0 +1,150 @@
+#include "perfcounters.h"
+
+#ifdef PERF_COUNTERS
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int COUNTERS = 4;//cycles, instructions, cache misses, branch misses
+const char * PHASE_NAMES[static_cast<int>(PerfPhase::Count)] = {
+    "search", "ordering", "legal_moves", "move_generation", "check_detection", "evaluation", "pawn_structure", "exchange"
+};
+
+uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//one perf_event group per thread, opened on first use
+struct ThreadCounters {
+    int fds[3] = {-1, -1, -1};//the first leads the group
+    int group = -1;
+    bool events_available = false;
+    uint64_t totals[static_cast<int>(PerfPhase::Count)][COUNTERS] = {};
+    uint64_t calls[static_cast<int>(PerfPhase::Count)] = {};
+
+    ThreadCounters() {
+#if defined(__linux__)
+        const uint64_t configs[3] = {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for(int i = 0; i < 3; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.disabled = i == 0;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+            if(fds[i] < 0) {
+                close_events();
+                return;
+            }
+            if(i == 0) group = fds[i];
+        }
+        ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        events_available = true;
+#endif
+    }
+    ~ThreadCounters() {
+        close_events();
+    }
+    void close_events() {
+#if defined(__linux__)
+        for(int &fd : fds) {
+            if(fd >= 0) close(fd);
+            fd = -1;
+        }
+#endif
+        group = -1;
+        events_available = false;
+    }
+    void read(uint64_t values[COUNTERS]) {
+        values[0] = cycles();
+        values[1] = values[2] = values[3] = 0;
+#if defined(__linux__)
+        if(!events_available) return;
+        uint64_t buffer[4];//count, then one value per event
+        if(::read(group, buffer, sizeof(buffer)) == sizeof(buffer)) {
+            values[1] = buffer[1];
+            values[2] = buffer[2];
+            values[3] = buffer[3];
+        }
+#endif
+    }
+};
+
+ThreadCounters &thread_counters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+}
+
+PerfScope::PerfScope(PerfPhase phase) {
+    this->phase = phase;
+    thread_counters().read(start);
+}
+
+PerfScope::~PerfScope() {
+    ThreadCounters &counters = thread_counters();
+    uint64_t end[COUNTERS];
+    counters.read(end);
+    int index = static_cast<int>(phase);
+    for(int i = 0; i < COUNTERS; i++) {
+        counters.totals[index][i] += end[i] - start[i];
+    }
+    counters.calls[index]++;
+}
+
+std::string perf_report() {
+    ThreadCounters &counters = thread_counters();
+    std::string report;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-16s %10s %12s %12s %6s %12s %12s\n", "phase", "calls", "cycles/call",
+                  "instr/call", "ipc", "cmiss/call", "bmiss/call");
+    report += line;
+    for(int phase = 0; phase < static_cast<int>(PerfPhase::Count); phase++) {
+        uint64_t calls = counters.calls[phase];
+        if(calls == 0) continue;
+        const uint64_t * total = counters.totals[phase];
+        if(counters.events_available) {
+            std::snprintf(line, sizeof(line), "%-16s %10llu %12.0f %12.0f %6.2f %12.2f %12.2f\n", PHASE_NAMES[phase],
+                          static_cast<unsigned long long>(calls), double(total[0]) / calls, double(total[1]) / calls,
+                          total[0] ? double(total[1]) / total[0] : 0.0, double(total[2]) / calls, double(total[3]) / calls);
+        }
+        else {
+            std::snprintf(line, sizeof(line), "%-16s %10llu %12.0f %12s %6s %12s %12s\n", PHASE_NAMES[phase],
+                          static_cast<unsigned long long>(calls), double(total[0]) / calls, "-", "-", "-", "-");
+        }
+        report += line;
+    }
+    if(!counters.events_available) report += "(perf_event unavailable, cycles only)\n";
+    return report;
+}
+
+void perf_reset() {
+    ThreadCounters &counters = thread_counters();
+    std::memset(counters.totals, 0, sizeof(counters.totals));
+    std::memset(counters.calls, 0, sizeof(counters.calls));
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include "chessboard.h"
+
+#include <cstdint>
+#include <string>
+
+/*
+    Per-phase cost accounting for the engine's hot paths, compiled in only
+    with PERF_COUNTERS (see chessboard.h) so the default build pays nothing.
+
+    A PERF_SCOPE records elapsed cycles (the time-stamp counter on x86) and, on Linux where perf_event is
+    permitted, retired instructions, cache misses and branch misses into
+    the calling thread's totals. Phases nest and are measured inclusively,
+    e.g. legal move generation includes the pseudo-legal generation it
+    calls. Reading the counters is a system call per scope, so absolute
+    numbers are inflated; compare phases and builds rather than trusting
+    the totals.
+*/
+
+enum class PerfPhase {
+    Search,//one iteration of iterative deepening
+    Ordering,//making each child and its static evaluation for move ordering
+    LegalMoves,
+    MoveGeneration,//pseudo-legal
+    CheckDetection,
+    Evaluation,
+    PawnStructure,//pawn hash misses only
+    Exchange,//SEE
+    Count
+};
+
+#ifdef PERF_COUNTERS
+
+class PerfScope
+{
+public:
+    explicit PerfScope(PerfPhase phase);
+    ~PerfScope();
+private:
+    PerfPhase phase;
+    uint64_t start[4];
+};
+
+#define PERF_SCOPE_NAME(line) perf_scope_##line
+#define PERF_SCOPE_AT(phase, line) PerfScope PERF_SCOPE_NAME(line)(phase)
+#define PERF_SCOPE(phase) PERF_SCOPE_AT(phase, __LINE__)
+
+std::string perf_report();//the calling thread's totals since its last reset, one line per phase
+void perf_reset();
+
+#else
+
+#define PERF_SCOPE(phase)
+
+#endif
+
+#endif // PERFCOUNTERS_H
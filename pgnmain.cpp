@@ -0,0 +1,78 @@
+#include "pgnreader.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("chess_pgn");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays every game of a PGN archive in parallel");
+    parser.addHelpOption();
+    parser.addPositionalArgument("games", "PGN file.");
+    QCommandLineOption threads_option("threads", "Replay threads.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption positions_option("positions", "Write every position with the game result, as chess_tune reads them.", "file");
+    QCommandLineOption skip_option("skip-plies", "Opening plies left out of --positions.", "plies", "8");
+    parser.addOptions({threads_option, positions_option, skip_option});
+    parser.process(a);
+    if(parser.positionalArguments().size() != 1) parser.showHelp(1);
+
+    PgnReader reader(parser.positionalArguments().first());
+    if(!reader.is_open()) {
+        fprintf(stderr, "could not open %s: %s\n", qPrintable(parser.positionalArguments().first()), qPrintable(reader.error_string()));
+        return 1;
+    }
+    QFile positions(parser.value(positions_option));
+    if(parser.isSet(positions_option) && !positions.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fprintf(stderr, "could not open %s\n", qPrintable(positions.fileName()));
+        return 1;
+    }
+    int skip_plies = parser.value(skip_option).toInt();
+
+    QMutex positions_mutex;
+    std::atomic<int64_t> plies(0);
+    std::atomic<int64_t> failed(0);
+    QElapsedTimer timer;
+    timer.start();
+    int64_t games = reader.for_each([&](const PgnGame &game) {
+        std::string_view result = game.tag("Result");
+        bool labelled = positions.isOpen() && (result == "1-0" || result == "0-1" || result == "1/2-1/2");
+        std::string lines;
+        int ply = 0;
+        int played = pgn_replay(game, [&](ChessBoard &board, Team to_move, std::string_view) {
+            if(labelled && ply++ >= skip_plies) {
+                lines += board.to_fen(to_move);
+                lines += ' ';
+                lines += result;
+                lines += '\n';
+            }
+            return true;
+        });
+        if(played < 0) {
+            failed++;
+            return;
+        }
+        plies += played;
+        if(!lines.empty()) {
+            QMutexLocker locker(&positions_mutex);
+            positions.write(lines.data(), static_cast<qint64>(lines.size()));
+        }
+    }, parser.value(threads_option).toInt());
+
+    double seconds = std::max<qint64>(timer.elapsed(), 1) / 1000.0;
+    printf("%lld games, %lld plies, %lld games with an unresolved move\n", static_cast<long long>(games),
+           static_cast<long long>(plies.load()), static_cast<long long>(failed.load()));
+    printf("%.2f s, %.0f games/s, %.0f plies/s, %.1f MB/s\n", seconds, games / seconds, plies.load() / seconds,
+           reader.size() / seconds / (1 << 20));
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include "pgnreader.h"
+
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string_view PgnGame::tag(std::string_view name) const {
+    size_t i = 0;
+    while(i < tags.size()) {
+        size_t end = tags.find('\n', i);
+        if(end == std::string_view::npos) end = tags.size();
+        std::string_view line = tags.substr(i, end - i);
+        i = end + 1;
+        //[Name "value"]
+        if(line.size() < name.size() + 4 || line[0] != '[' || line.substr(1, name.size()) != name) continue;
+        if(line[name.size() + 1] != ' ') continue;
+        size_t open = line.find('"', name.size() + 2);
+        size_t close = line.rfind('"');
+        if(open == std::string_view::npos || close <= open) continue;
+        return line.substr(open + 1, close - open - 1);
+    }
+    return std::string_view();
+}
+
+PgnReader::PgnReader(const QString &path) : file(path) {
+    data = nullptr;
+    length = 0;
+    position = 0;
+    games = 0;
+    if(!file.open(QIODevice::ReadOnly)) return;
+    length = static_cast<size_t>(file.size());
+    if(length > 0) data = reinterpret_cast<const char *>(file.map(0, file.size()));
+    if(!data) length = 0;
+    //a byte order mark would otherwise hide the first tag
+    if(length >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) position = 3;
+}
+
+bool PgnReader::is_open() const {
+    return file.isOpen() && (data || file.size() == 0);
+}
+
+QString PgnReader::error_string() const {
+    return file.errorString();
+}
+
+bool PgnReader::next(PgnGame &game) {
+    size_t p = position;
+    while(p < length && is_space(data[p])) p++;
+    if(p >= length) {
+        position = length;
+        return false;
+    }
+
+    size_t tags_begin = p;
+    while(p < length && data[p] == '[') {
+        const void * end = std::memchr(data + p, '\n', length - p);
+        p = end ? static_cast<const char *>(end) - data + 1 : length;
+        while(p < length && is_space(data[p])) p++;
+    }
+    size_t tags_end = p;
+
+    //movetext runs until a line opens the next game's tags, comments may span lines
+    size_t movetext_begin = p;
+    bool line_start = false;
+    bool in_comment = false;
+    while(p < length) {
+        char c = data[p];
+        if(line_start && c == '[' && !in_comment) break;
+        if(c == '{') in_comment = true;
+        else if(c == '}') in_comment = false;
+        else if(c == ';' && !in_comment) {
+            const void * end = std::memchr(data + p, '\n', length - p);
+            p = end ? static_cast<const char *>(end) - data : length;
+            continue;
+        }
+        if(c == '\n') line_start = true;
+        else if(!is_space(c)) line_start = false;
+        p++;
+    }
+
+    game.tags = std::string_view(data + tags_begin, tags_end - tags_begin);
+    game.movetext = std::string_view(data + movetext_begin, p - movetext_begin);
+    game.index = games++;
+    position = p;
+    return true;
+}
+
+int64_t PgnReader::for_each(const std::function<void(const PgnGame &)> &visit, int workers) {
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, workers));
+    //bounds how far the scanner may run ahead of the workers
+    QSemaphore slots(std::max(1, workers) * 4);
+    int64_t count = 0;
+
+    std::vector<PgnGame> batch;
+    batch.reserve(BATCH_GAMES);
+    auto dispatch = [&]() {
+        slots.acquire();
+        pool.start([batch, &visit, &slots]() {
+            for(const PgnGame &game : batch) visit(game);
+            slots.release();
+        });
+        batch.clear();
+    };
+
+    PgnGame game;
+    while(next(game)) {
+        batch.push_back(game);
+        count++;
+        if(batch.size() >= static_cast<size_t>(BATCH_GAMES)) dispatch();
+    }
+    if(!batch.empty()) dispatch();
+    pool.waitForDone();
+    return count;
+}
+
+static bool holds(ChessBoard &board, QPoint square, Piece piece) {
+    std::optional<Piece> &p = board.at(square);
+    return p.has_value() && p->team == piece.team && p->rank == piece.rank;
+}
+
+static std::optional<Rank> rank_from_letter(char c) {
+    switch(c) {
+    case 'N': return Rank::Knight;
+    case 'B': return Rank::Bishop;
+    case 'R': return Rank::Rook;
+    case 'Q': return Rank::Queen;
+    case 'K': return Rank::King;
+    }
+    return std::nullopt;
+}
+
+bool pgn_play_san(ChessBoard &board, Team team, std::string_view san, Move * played) {
+    if(san.size() > 4 && san.substr(san.size() - 4) == "e.p.") san.remove_suffix(4);
+    while(!san.empty() && std::strchr("+#!?", san.back())) san.remove_suffix(1);
+    int home = team == Team::Alpha ? 7 : 0;
+
+    if(san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool king_side = san.size() == 3;
+        QPoint king(4, home);
+        QPoint rook(king_side ? 7 : 0, home);
+        QPoint king_dest(king_side ? 6 : 2, home);
+        QPoint rook_dest(king_side ? 5 : 3, home);
+        if(!holds(board, king, Piece(team, Rank::King)) || !holds(board, rook, Piece(team, Rank::Rook))) return false;
+        for(int x = std::min(king.x(), rook.x()) + 1; x < std::max(king.x(), rook.x()); x++) {
+            if(board.at(x, home).has_value()) return false;
+        }
+        Move m{Piece(team, Rank::King), king, king_dest};
+        board.do_move(m);
+        board.place(rook_dest, board.at(rook));
+        board.place(rook, std::nullopt);
+        if(played) *played = m;
+        return true;
+    }
+
+    std::optional<Rank> promotion;
+    if(san.size() > 2 && std::strchr("QRBN", san.back())) {
+        promotion = rank_from_letter(san.back());
+        san.remove_suffix(1);
+        if(!san.empty() && san.back() == '=') san.remove_suffix(1);
+    }
+    if(san.size() < 2) return false;
+    char file = san[san.size() - 2];
+    char rank_digit = san.back();
+    if(file < 'a' || file > 'h' || rank_digit < '1' || rank_digit > '8') return false;
+    QPoint dest(file - 'a', '8' - rank_digit);
+    san.remove_suffix(2);
+
+    Rank rank = Rank::Pawn;
+    if(!san.empty() && rank_from_letter(san.front())) {
+        rank = *rank_from_letter(san.front());
+        san.remove_prefix(1);
+    }
+    int from_x = -1;
+    int from_y = -1;
+    for(char c : san) {
+        if(c >= 'a' && c <= 'h') from_x = c - 'a';
+        else if(c >= '1' && c <= '8') from_y = '8' - c;
+        else if(c != 'x' && c != ':' && c != '-') return false;
+    }
+
+    std::optional<Move> match;
+    for(Move m : board.gen_filtered_children_moves(team)) {
+        if(m.piece.rank != rank || m.destination != dest) continue;
+        if(from_x >= 0 && m.origin.x() != from_x) continue;
+        if(from_y >= 0 && m.origin.y() != from_y) continue;
+        if(match) return false;//ambiguous
+        match = m;
+    }
+
+    if(!match && rank == Rank::Pawn && from_x >= 0 && !board.at(dest).has_value()) {
+        //en passant, the captured pawn sits beside the capturing one
+        int forward = team == Team::Alpha ? -1 : 1;
+        QPoint origin(from_x, dest.y() - forward);
+        QPoint captured(dest.x(), dest.y() - forward);
+        if(std::abs(from_x - dest.x()) != 1 || !ChessBoard::in_bounds(origin)) return false;
+        if(!holds(board, origin, Piece(team, Rank::Pawn)) || !holds(board, captured, Piece(team_inverse(team), Rank::Pawn))) return false;
+        Move m{Piece(team, Rank::Pawn), origin, dest};
+        board.do_move(m);
+        board.place(captured, std::nullopt);
+        if(played) *played = m;
+        return true;
+    }
+    if(!match) return false;
+
+    board.do_move(*match);
+    if(rank == Rank::Pawn && (dest.y() == 0 || dest.y() == 7)) {
+        board.place(dest, Piece(team, promotion.value_or(Rank::Queen)));
+    }
+    if(played) *played = *match;
+    return true;
+}
+
+int pgn_replay(const PgnGame &game, const std::function<bool(ChessBoard &board, Team to_move, std::string_view san)> &visit) {
+    Team to_move = Team::Alpha;
+    ChessBoard board;
+    std::string_view fen = game.tag("FEN");
+    if(!fen.empty()) {
+        std::optional<ChessBoard> position = ChessBoard::from_fen(std::string(fen), &to_move);
+        if(!position) return -1;
+        board = *position;
+    }
+
+    std::string_view text = game.movetext;
+    int plies = 0;
+    int variation_depth = 0;
+    size_t i = 0;
+    while(i < text.size()) {
+        char c = text[i];
+        if(is_space(c)) {
+            i++;
+            continue;
+        }
+        if(c == '{') {
+            size_t end = text.find('}', i);
+            i = end == std::string_view::npos ? text.size() : end + 1;
+            continue;
+        }
+        if(c == ';') {
+            size_t end = text.find('\n', i);
+            i = end == std::string_view::npos ? text.size() : end + 1;
+            continue;
+        }
+        if(c == '(' || c == ')') {
+            variation_depth += c == '(' ? 1 : -1;
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while(i < text.size() && !is_space(text[i]) && !std::strchr("{}();", text[i])) i++;
+        std::string_view token = text.substr(start, i - start);
+        if(variation_depth > 0 || token[0] == '$') continue;//side lines and annotation glyphs
+        if(token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") break;
+
+        //move numbers, possibly glued to the move as in 12.Nf3 or 12...Nf6
+        size_t digits = 0;
+        while(digits < token.size() && token[digits] >= '0' && token[digits] <= '9') digits++;
+        if(digits > 0 && digits < token.size() && token[digits] == '.') {
+            while(digits < token.size() && token[digits] == '.') digits++;
+            token.remove_prefix(digits);
+            if(token.empty()) continue;
+        }
+
+        if(visit && !visit(board, to_move, token)) return plies;
+        if(!pgn_play_san(board, to_move, token)) return -1;
+        to_move = team_inverse(to_move);
+        plies++;
+    }
+    return plies;
+}
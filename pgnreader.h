@@ -0,0 +1,59 @@
+#ifndef PGNREADER_H
+#define PGNREADER_H
+
+#include "chessboard.h"
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/*
+    Streaming reader for PGN archives. The file is memory-mapped and games
+    are handed out as views into the mapping, so scanning allocates nothing
+    per game or per move. Views stay valid as long as the reader does.
+
+    SAN is resolved against the legal move generator. Castling, en passant
+    and promotions are applied here on top of it, since the engine does not
+    generate them.
+*/
+
+struct PgnGame {
+    std::string_view tags;//the tag pair section
+    std::string_view movetext;
+    int64_t index = 0;//order in the file, from 0
+    std::string_view tag(std::string_view name) const;//value of [name "value"], empty if missing
+};
+
+class PgnReader
+{
+public:
+    explicit PgnReader(const QString &path);
+    bool is_open() const;
+    QString error_string() const;
+    bool next(PgnGame &game);//false once the file is exhausted
+    //hands the remaining games to visit on a pool of workers, in batches, and returns how many there were
+    int64_t for_each(const std::function<void(const PgnGame &)> &visit, int workers);
+    size_t size() const {return length;}
+    size_t offset() const {return position;}
+
+private:
+    QFile file;
+    const char * data;
+    size_t length;
+    size_t position;
+    int64_t games;
+
+    static const int BATCH_GAMES = 256;
+};
+
+//plays one SAN move for team, false unless it names exactly one legal move
+bool pgn_play_san(ChessBoard &board, Team team, std::string_view san, Move * played = nullptr);
+
+//replays the game from its FEN tag or the start position, showing visit every position before its move;
+//returns the plies played, or -1 at the first move that does not resolve
+int pgn_replay(const PgnGame &game,
+               const std::function<bool(ChessBoard &board, Team to_move, std::string_view san)> &visit = {});
+
+#endif // PGNREADER_H
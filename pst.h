@@ -0,0 +1,93 @@
+#ifndef PST_H
+#define PST_H
+
+#include "chessboard.h"
+
+/*
+    Piece-square tables for the tapered evaluation, built at compile time.
+    Each table entry already includes the piece's material value and is
+    signed for its team, indexed [team][rank][x + y*8] like the board.
+    The shapes are written once from Alpha's side (home rank at y = 7)
+    and mirrored for Beta.
+*/
+
+struct PieceSquareTables {
+    int mg[2][6][64];
+    int eg[2][6][64];
+};
+
+//centipawns, indexed by Rank
+constexpr int MG_VALUE[6] = {100, 300, 400, 500, 900, 0};
+constexpr int EG_VALUE[6] = {120, 280, 380, 520, 920, 0};
+
+//non-pawn material left decides how far into the endgame we are
+constexpr int PHASE_WEIGHT[6] = {0, 1, 1, 2, 4, 0};
+constexpr int PHASE_TOTAL = 24;
+
+//0 on the four centre squares up to 6 in the corners
+constexpr int pst_center_distance(int x, int y) {
+    int dx = x < 4 ? 3 - x : x - 4;
+    int dy = y < 4 ? 3 - y : y - 4;
+    return dx + dy;
+}
+
+//r counts ranks forward from Alpha's home rank
+constexpr int pst_mg_shape(int rank, int x, int r) {
+    int center = pst_center_distance(x, 7 - r);
+    bool central_file = x == 3 || x == 4;
+    switch(rank) {
+    case Rank::Pawn:
+        return r > 1 ? (r - 1) * (central_file ? 10 : 5) : 0;
+    case Rank::Knight:
+        return 15 - 8 * center;
+    case Rank::Bishop:
+        return 10 - 4 * center;
+    case Rank::Rook:
+        return (r == 6 ? 20 : 0) + (central_file ? 5 : 0);
+    case Rank::Queen:
+        return 5 - 2 * center;
+    case Rank::King:
+        return r == 0 ? (x <= 2 || x >= 6 ? 20 : 0) : -15 * r;
+    }
+    return 0;
+}
+
+constexpr int pst_eg_shape(int rank, int x, int r) {
+    int center = pst_center_distance(x, 7 - r);
+    switch(rank) {
+    case Rank::Pawn:
+        return r > 1 ? (r - 1) * (r - 1) * 3 : 0;
+    case Rank::Knight:
+        return 10 - 6 * center;
+    case Rank::Bishop:
+        return 8 - 3 * center;
+    case Rank::Rook:
+        return r == 6 ? 15 : 0;
+    case Rank::Queen:
+        return 6 - 3 * center;
+    case Rank::King:
+        return 20 - 8 * center;
+    }
+    return 0;
+}
+
+constexpr PieceSquareTables make_piece_square_tables() {
+    PieceSquareTables tables{};
+    for(int rank = 0; rank < 6; rank++) {
+        for(int y = 0; y < 8; y++) {
+            for(int x = 0; x < 8; x++) {
+                int mg = MG_VALUE[rank] + pst_mg_shape(rank, x, 7 - y);
+                int eg = EG_VALUE[rank] + pst_eg_shape(rank, x, 7 - y);
+                tables.mg[Team::Alpha][rank][x + y*8] = mg;
+                tables.eg[Team::Alpha][rank][x + y*8] = eg;
+                tables.mg[Team::Beta][rank][x + (7 - y)*8] = -mg;
+                tables.eg[Team::Beta][rank][x + (7 - y)*8] = -eg;
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr PieceSquareTables PIECE_SQUARE_TABLES = make_piece_square_tables();
+
+#endif // PST_H
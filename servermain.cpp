@@ -0,0 +1,54 @@
+#include "analysisserver.h"
+#include "engineoptions.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("chess_server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Chess analysis server speaking JSON lines");
+    parser.addHelpOption();
+    QCommandLineOption socket_option("socket", "Listen on the local socket <name>.", "name", "chess-analysis");
+    QCommandLineOption tcp_option("tcp", "Also listen on 127.0.0.1:<port>.", "port");
+    QCommandLineOption workers_option("workers", "Number of searches run at once.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption queue_option("queue", "Requests that may wait for a worker before clients get busy replies.", "count", "64");
+    QCommandLineOption hash_option("hash", "Shared transposition table size.", "MB", "64");
+    QCommandLineOption hash_file_option("hash-file", "Keep the transposition table in <file> so it survives restarts and is shared with other servers using it.", "file");
+    QCommandLineOption hash_readonly_option("hash-readonly", "Start from the hash file but keep this server's results out of it.");
+    QCommandLineOption cpus_option("cpus", "Keep the workers on these cores, e.g. 2-5,7.", "list");
+    parser.addOptions({socket_option, tcp_option, workers_option, queue_option, hash_option, hash_file_option, hash_readonly_option, cpus_option});
+    parser.process(a);
+
+    std::vector<int> cpus;
+    if(parser.isSet(cpus_option) && !parse_cpu_list(parser.value(cpus_option), cpus)) {
+        fprintf(stderr, "--cpus expects a list like 0-3,6\n");
+        return 1;
+    }
+
+    AnalysisServer server(std::max(1, parser.value(workers_option).toInt()),
+                          std::max(0, parser.value(queue_option).toInt()),
+                          std::max(1, parser.value(hash_option).toInt()),
+                          parser.value(hash_file_option),
+                          parser.isSet(hash_readonly_option) ? TranspositionTable::Mapping::Private : TranspositionTable::Mapping::Shared);
+    if(parser.isSet(hash_file_option) && !server.transposition_table().is_mapped()) {
+        fprintf(stderr, "could not map %s, using an in-memory table: %s\n", qPrintable(parser.value(hash_file_option)),
+                qPrintable(server.transposition_table().error_string()));
+    }
+    server.set_worker_cpus(cpus);
+    if(!server.listen_local(parser.value(socket_option))) {
+        fprintf(stderr, "could not listen on %s: %s\n", qPrintable(parser.value(socket_option)), qPrintable(server.error_string()));
+        return 1;
+    }
+    if(parser.isSet(tcp_option) && !server.listen_tcp(parser.value(tcp_option).toUShort())) {
+        fprintf(stderr, "could not listen on port %s: %s\n", qPrintable(parser.value(tcp_option)), qPrintable(server.error_string()));
+        return 1;
+    }
+    return a.exec();
+}
@@ -0,0 +1,164 @@
+#include "texeltuner.h"
+
+#include <QFile>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static const double HEURISTIC_PER_CENTIPAWN = 10;//at the default material weight
+
+//splits "<fen> <result>" into the fen and white's score, false if the line is not labelled
+static bool parse_labelled(const QByteArray &line, std::string &fen, double &result) {
+    QList<QByteArray> fields = line.simplified().split(' ');
+    while(!fields.isEmpty()) {
+        QByteArray label = fields.takeLast();
+        while(!label.isEmpty() && QByteArray("[]\";").contains(label.back())) label.chop(1);
+        while(!label.isEmpty() && QByteArray("[]\";").contains(label.front())) label.remove(0, 1);
+        if(label.isEmpty() || label == "c9") continue;//EPD result opcode
+        if(label == "1-0" || label == "1.0" || label == "1") result = 1;
+        else if(label == "0-1" || label == "0.0" || label == "0") result = 0;
+        else if(label == "1/2-1/2" || label == "0.5") result = 0.5;
+        else return false;
+        if(!fields.isEmpty() && fields.last() == "c9") fields.removeLast();
+        fen = fields.join(' ').toStdString();
+        return !fen.empty();
+    }
+    return false;
+}
+
+static double sigmoid(int eval, double k) {
+    return 1 / (1 + std::pow(10.0, -k * (eval / HEURISTIC_PER_CENTIPAWN) / 400));
+}
+
+TexelTuner::TexelTuner(const QString &path, int batch_lines) {
+    this->path = path;
+    this->batch_lines = std::max(1, batch_lines);
+    position_count = 0;
+    skipped_count = 0;
+    evaluation_count = 0;
+}
+
+bool TexelTuner::errors(const EvalParams &params, const std::vector<double> &ks, std::vector<double> &out) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    struct Slice {
+        int begin;
+        int end;
+        std::vector<double> sums;
+        int64_t count;
+        int64_t skipped;
+    };
+    std::vector<double> sums(ks.size(), 0);
+    int64_t count = 0;
+    int64_t skipped = 0;
+    QVector<QByteArray> batch;
+    batch.reserve(batch_lines);
+    int slices_per_batch = std::max(1, QThread::idealThreadCount() * 4);
+
+    auto flush = [&]() {
+        QVector<Slice> slices;
+        int slice_lines = (batch.size() + slices_per_batch - 1) / slices_per_batch;
+        for(int begin = 0; begin < batch.size(); begin += slice_lines) {
+            slices.append(Slice{begin, std::min<int>(begin + slice_lines, batch.size()), std::vector<double>(ks.size(), 0), 0, 0});
+        }
+        QtConcurrent::blockingMap(slices, [&](Slice &slice) {
+            std::string fen;
+            double result;
+            for(int i = slice.begin; i < slice.end; i++) {
+                Team to_move = Team::Alpha;
+                std::optional<ChessBoard> board;
+                if(parse_labelled(batch[i], fen, result)) board = ChessBoard::from_fen(fen, &to_move);
+                if(!board) {
+                    slice.skipped++;
+                    continue;
+                }
+                int eval = board->heuristic(to_move, params);
+                for(size_t j = 0; j < ks.size(); j++) {
+                    double error = result - sigmoid(eval, ks[j]);
+                    slice.sums[j] += error * error;
+                }
+                slice.count++;
+            }
+        });
+        for(const Slice &slice : slices) {
+            for(size_t j = 0; j < ks.size(); j++) sums[j] += slice.sums[j];
+            count += slice.count;
+            skipped += slice.skipped;
+        }
+        batch.clear();
+    };
+
+    while(!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith('#')) continue;
+        batch.append(line);
+        if(batch.size() >= batch_lines) flush();
+    }
+    if(!batch.isEmpty()) flush();
+
+    position_count = count;
+    skipped_count = skipped;
+    evaluation_count += count;
+    if(count == 0) return false;
+    out.resize(ks.size());
+    for(size_t j = 0; j < ks.size(); j++) out[j] = sums[j] / count;
+    return true;
+}
+
+double TexelTuner::error(const EvalParams &params, double k) {
+    std::vector<double> out;
+    if(!errors(params, {k}, out)) return -1;
+    return out[0];
+}
+
+double TexelTuner::fit_k(const EvalParams &params) {
+    std::vector<double> ks;
+    for(int i = 1; i <= 300; i++) ks.push_back(i * 0.01);
+    std::vector<double> out;
+    if(!errors(params, ks, out)) return -1;
+    return ks[std::min_element(out.begin(), out.end()) - out.begin()];
+}
+
+EvalParams TexelTuner::tune(EvalParams params, double k, const std::vector<int> &indices, int max_passes) {
+    double best = error(params, k);
+    if(best < 0) return params;
+    printf("start: error %.6f over %lld positions\n", best, static_cast<long long>(position_count));
+
+    std::vector<int> steps(EvalParams::Count);
+    for(int index : indices) steps[index] = std::max(1, std::abs(params.weights[index]) / 10);
+
+    for(int pass = 1; pass <= max_passes; pass++) {
+        bool improved = false;
+        for(int index : indices) {
+            bool moved = false;
+            for(int direction : {1, -1}) {
+                EvalParams candidate = params;
+                candidate.weights[index] += direction * steps[index];
+                double candidate_error = error(candidate, k);
+                if(candidate_error >= 0 && candidate_error < best) {
+                    best = candidate_error;
+                    params = candidate;
+                    moved = true;
+                    break;
+                }
+            }
+            if(moved) improved = true;
+            else if(steps[index] > 1) {
+                steps[index] /= 2;
+                improved = true;//retry at the finer step
+            }
+        }
+
+        printf("pass %d: error %.6f", pass, best);
+        for(int index : indices) printf(" %s=%d", EvalParams::name(index), params.weights[index]);
+        printf("\n");
+        fflush(stdout);
+        if(!improved) break;
+    }
+    return params;
+}
@@ -0,0 +1,46 @@
+#ifndef TEXELTUNER_H
+#define TEXELTUNER_H
+
+#include "chessboard.h"
+
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+/*
+    Texel tuning of EvalParams. The labelled position file is streamed from
+    disk in batches, one "<fen> <result>" per line with the result from
+    white's side as 1-0, 0-1, 1/2-1/2 or 1.0/0.5/0.0 (optionally in
+    brackets or quotes). Each batch is evaluated with heuristic() across
+    the global thread pool and the mean squared error between the game
+    result and sigmoid(eval) is minimized by integer local search.
+*/
+
+class TexelTuner
+{
+public:
+    TexelTuner(const QString &path, int batch_lines = 1 << 16);
+
+    //mean squared error of params over the whole file, -1 if unreadable
+    double error(const EvalParams &params, double k);
+    //sigmoid scale minimizing the error of params, from a single pass
+    double fit_k(const EvalParams &params);
+    //repeated +-step probes per weight, halving the step when nothing improves
+    EvalParams tune(EvalParams params, double k, const std::vector<int> &indices, int max_passes);
+
+    int64_t positions() const {return position_count;}
+    int64_t skipped() const {return skipped_count;}
+    int64_t evaluations() const {return evaluation_count;}
+
+private:
+    QString path;
+    int batch_lines;
+    int64_t position_count;
+    int64_t skipped_count;//lines that did not parse
+    int64_t evaluation_count;
+
+    //errors for every k in ks from one pass over the file
+    bool errors(const EvalParams &params, const std::vector<double> &ks, std::vector<double> &out);
+};
+
+#endif // TEXELTUNER_H
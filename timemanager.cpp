@@ -0,0 +1,54 @@
+#include "timemanager.h"
+
+#include <algorithm>
+
+TimeManager::TimeManager(int64_t time_left, int64_t increment, int moves_to_go) {
+    int64_t usable = std::max<int64_t>(time_left - MOVE_OVERHEAD, 1);
+    int moves = moves_to_go > 0 ? moves_to_go : DEFAULT_MOVES_TO_GO;
+    //the last move before a time control may use everything that is left
+    int64_t ceiling = moves_to_go == 1 ? usable : std::max<int64_t>(usable / MAX_CLOCK_SHARE, 1);
+    soft = std::clamp<int64_t>(usable / moves + increment * INCREMENT_SHARE / 100, 1, ceiling);
+    hard = std::min(soft * HARD_FACTOR, ceiling);
+    scale = 100;
+    stable_iterations = 0;
+    previous_elapsed = 0;
+    last_iteration_time = 0;
+    growth = DEFAULT_GROWTH;
+}
+
+int64_t TimeManager::soft_budget() const {
+    return std::min(soft * scale / 100, hard);
+}
+
+int64_t TimeManager::hard_budget() const {
+    return hard;
+}
+
+void TimeManager::iteration_finished(Move best, int score, Team team, int64_t elapsed) {
+    if(best_move && *best_move == best) stable_iterations++;
+    else stable_iterations = 0;
+    bool changed = best_move.has_value() && stable_iterations == 0;
+    best_move = best;
+
+    int side_score = ChessBoard::centipawns(team == Team::Alpha ? score : -score);
+    int drop = previous_score ? *previous_score - side_score : 0;
+    previous_score = side_score;
+
+    scale = 100;
+    if(changed) scale = UNSTABLE_SCALE;
+    else if(stable_iterations >= STABLE_ITERATIONS) scale = STABLE_SCALE;
+    if(drop >= SCORE_DROP_CENTIPAWNS * 2) scale = scale * SCORE_DROP_SCALE * 2 / 100;
+    else if(drop >= SCORE_DROP_CENTIPAWNS) scale = scale * SCORE_DROP_SCALE / 100;
+    scale = std::clamp(scale, MIN_SCALE, MAX_SCALE);
+
+    int64_t iteration_time = elapsed - previous_elapsed;
+    if(last_iteration_time > 0) growth = std::clamp<int64_t>(iteration_time * 100 / last_iteration_time, 150, 1000);
+    last_iteration_time = std::max<int64_t>(iteration_time, 1);
+    previous_elapsed = elapsed;
+}
+
+bool TimeManager::start_next_iteration(int64_t elapsed) const {
+    if(elapsed >= soft_budget()) return false;
+    //an iteration that would be cut off by the hard budget only wastes the time it gets
+    return elapsed + last_iteration_time * growth / 100 <= hard;
+}
@@ -0,0 +1,53 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+#include "chessboard.h"
+
+#include <cstdint>
+#include <optional>
+
+/*
+    Splits a game clock into a budget for one move. The soft budget is the
+    time a move normally gets, the hard budget is never exceeded. After
+    each iteration the soft budget is stretched when the best move keeps
+    changing or the score drops, and shrunk once the best move has settled.
+    No iteration is started that is not expected to finish in time.
+    All times are in milliseconds.
+*/
+
+class TimeManager
+{
+public:
+    TimeManager(int64_t time_left, int64_t increment, int moves_to_go = 0);
+    int64_t soft_budget() const;//after the latest adjustment
+    int64_t hard_budget() const;
+    void iteration_finished(Move best, int score, Team team, int64_t elapsed);//score Alpha positive, as searched
+    bool start_next_iteration(int64_t elapsed) const;
+
+private:
+    int64_t soft;
+    int64_t hard;
+    int scale;//percent of soft
+    std::optional<Move> best_move;
+    int stable_iterations;//in a row with the same best move
+    std::optional<int> previous_score;//centipawns for the side to move
+    int64_t previous_elapsed;
+    int64_t last_iteration_time;
+    int growth;//percent, last iteration time over the one before
+
+    static const int DEFAULT_MOVES_TO_GO = 30;
+    static const int MOVE_OVERHEAD = 20;//reserved per move for everything outside the search
+    static const int INCREMENT_SHARE = 75;//percent of the increment spent on top of the base share
+    static const int HARD_FACTOR = 4;//hard budget over soft budget
+    static const int MAX_CLOCK_SHARE = 4;//no move takes more than 1/n of the clock
+    static const int STABLE_ITERATIONS = 2;
+    static const int STABLE_SCALE = 70;
+    static const int UNSTABLE_SCALE = 160;
+    static const int SCORE_DROP_CENTIPAWNS = 30;
+    static const int SCORE_DROP_SCALE = 150;//and double that for a drop twice as large
+    static const int MIN_SCALE = 50;
+    static const int MAX_SCALE = 300;
+    static const int DEFAULT_GROWTH = 400;
+};
+
+#endif // TIMEMANAGER_H
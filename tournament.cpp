@@ -0,0 +1,272 @@
+#include "tournament.h"
+#include "transpositiontable.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const int REMOTE_TIMEOUT_MS = 600000;
+static const int FIFTY_MOVE_PLIES = 100;
+
+double Sprt::llr(int wins, int draws, int losses) const {
+    //normal approximation of the trinomial likelihood ratio
+    double games = wins + draws + losses;
+    if(games == 0) return 0;
+    double points = wins + draws * 0.5;
+    double score = points / games;
+    double variance = (wins * std::pow(1 - score, 2) + draws * std::pow(0.5 - score, 2) + losses * std::pow(score, 2)) / games;
+    if(variance <= 0) return 0;
+    auto expected_score = [](double elo){
+        return 1 / (1 + std::pow(10, -elo / 400));
+    };
+    double score0 = expected_score(elo0);
+    double score1 = expected_score(elo1);
+    return (score1 - score0) * (2 * points - games * (score0 + score1)) / (2 * variance);
+}
+
+double Sprt::lower_bound() const {
+    return std::log(beta / (1 - alpha));
+}
+
+double Sprt::upper_bound() const {
+    return std::log((1 - beta) / alpha);
+}
+
+Sprt::Decision Sprt::decide(int wins, int draws, int losses) const {
+    double ratio = llr(wins, draws, losses);
+    if(ratio >= upper_bound()) return Decision::AcceptH1;
+    if(ratio <= lower_bound()) return Decision::AcceptH0;
+    return Decision::Continue;
+}
+
+class LocalPlayer : public EnginePlayer
+{
+public:
+    LocalPlayer(const SearchLimits &limits, int hash_megabytes) : limits(limits), table(hash_megabytes) {}
+    std::optional<Move> choose(const GamePosition &game) override {
+        ChessBoard board = game.board;
+        SearchLimits move_limits = limits;
+        if(game.timed) {
+            move_limits.time_left = game.clock[game.to_move];
+            move_limits.increment = game.increment;
+        }
+        table.new_search();
+        return board.search(game.to_move, move_limits, &table, nullptr, {}, game.history).best_move;
+    }
+private:
+    SearchLimits limits;
+    TranspositionTable table;
+};
+
+//blocking client for another build's chess_server, lives on the game's worker thread
+class RemotePlayer : public EnginePlayer
+{
+public:
+    RemotePlayer(QIODevice *socket, const SearchLimits &limits) : socket(socket), limits(limits), next_id(0) {}
+    std::optional<Move> choose(const GamePosition &game) override {
+        int id = ++next_id;
+        //the whole game rather than the current position, so the server sees repetitions
+        QJsonObject request{{"id", id}, {"fen", game.start_fen}, {"moves", QJsonArray::fromStringList(game.moves)}};
+        if(limits.depth > 0) request["depth"] = limits.depth;
+        if(limits.nodes > 0) request["nodes"] = static_cast<qint64>(limits.nodes);
+        if(limits.movetime > 0) request["movetime"] = static_cast<qint64>(limits.movetime);
+        if(game.timed) {
+            request["wtime"] = static_cast<qint64>(game.clock[Team::Alpha]);
+            request["btime"] = static_cast<qint64>(game.clock[Team::Beta]);
+            request["winc"] = static_cast<qint64>(game.increment);
+            request["binc"] = static_cast<qint64>(game.increment);
+        }
+        QByteArray line = QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n';
+        socket->write(line);
+        socket->waitForBytesWritten(REMOTE_TIMEOUT_MS);
+
+        while(true) {
+            while(!socket->canReadLine()) {
+                if(!socket->waitForReadyRead(REMOTE_TIMEOUT_MS)) return std::nullopt;
+            }
+            QJsonObject reply = QJsonDocument::fromJson(socket->readLine()).object();
+            if(reply.value("id").toInt() != id) continue;
+            QString type = reply.value("type").toString();
+            if(type == "busy") {
+                QThread::msleep(50);
+                socket->write(line);
+                socket->waitForBytesWritten(REMOTE_TIMEOUT_MS);
+                continue;
+            }
+            if(type == "bestmove") {
+                ChessBoard board = game.board;
+                return board.parse_move(reply.value("move").toString().toStdString(), game.to_move);
+            }
+            if(type == "error") return std::nullopt;
+        }
+    }
+private:
+    std::unique_ptr<QIODevice> socket;
+    SearchLimits limits;
+    int next_id;
+};
+
+std::unique_ptr<EnginePlayer> EnginePlayer::create(const QString &spec, const MatchSettings &settings) {
+    if(spec == "local") return std::make_unique<LocalPlayer>(settings.limits, settings.hash_megabytes);
+    if(spec.startsWith("socket:")) {
+        auto socket = std::make_unique<QLocalSocket>();
+        socket->connectToServer(spec.mid(7));
+        if(!socket->waitForConnected(5000)) return nullptr;
+        return std::make_unique<RemotePlayer>(socket.release(), settings.limits);
+    }
+    if(spec.startsWith("tcp:")) {
+        auto socket = std::make_unique<QTcpSocket>();
+        socket->connectToHost("127.0.0.1", spec.mid(4).toUShort());
+        if(!socket->waitForConnected(5000)) return nullptr;
+        return std::make_unique<RemotePlayer>(socket.release(), settings.limits);
+    }
+    return nullptr;
+}
+
+Tournament::Tournament(const MatchSettings &settings) {
+    this->settings = settings;
+    if(this->settings.openings.isEmpty()) {
+        this->settings.openings << "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    }
+    wins = 0;
+    draws = 0;
+    losses = 0;
+    played = 0;
+    stop = false;
+}
+
+int Tournament::run() {
+    if(!settings.results_path.isEmpty()) {
+        QFile results(settings.results_path);
+        if(!results.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "could not open %s\n", qPrintable(settings.results_path));
+            return 1;
+        }
+        results.write("game,opening,engine_a,result,plies,reason\n");
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(settings.concurrency);
+    for(int i = 0; i < settings.games; i++) {
+        //each opening is played twice with colours swapped
+        QString opening = settings.openings[(i / 2) % settings.openings.size()];
+        bool a_is_alpha = i % 2 == 0;
+        pool.start([this, i, opening, a_is_alpha]{
+            if(stop) return;
+            GameRecord game = play(opening, a_is_alpha);
+            record(i, opening, a_is_alpha, game);
+        });
+    }
+    pool.waitForDone();
+
+    QMutexLocker locker(&mutex);
+    printf("finished after %d games\n", played);
+    print_status();
+    return 0;
+}
+
+Tournament::GameRecord Tournament::play(const QString &opening, bool a_is_alpha) {
+    std::unique_ptr<EnginePlayer> engine_a = EnginePlayer::create(settings.engine_a, settings);
+    std::unique_ptr<EnginePlayer> engine_b = EnginePlayer::create(settings.engine_b, settings);
+    if(!engine_a || !engine_b) {
+        stop = true;
+        return GameRecord{Outcome::Aborted, 0, "engine unavailable"};
+    }
+
+    GamePosition game;
+    game.start_fen = opening;
+    std::optional<ChessBoard> board = ChessBoard::from_fen(opening.toStdString(), &game.to_move);
+    if(!board) return GameRecord{Outcome::Aborted, 0, "invalid opening"};
+    game.board = *board;
+    if(settings.base_time > 0) {
+        game.timed = true;
+        game.clock[Team::Alpha] = settings.base_time;
+        game.clock[Team::Beta] = settings.base_time;
+        game.increment = settings.increment;
+    }
+
+    for(int plies = 0; plies < settings.max_plies; plies++) {
+        if(stop) return GameRecord{Outcome::Aborted, plies, "stopped"};
+        Outcome loss = game.to_move == Team::Alpha ? Outcome::BetaWins : Outcome::AlphaWins;
+        if(game.board.gen_filtered_children_moves(game.to_move).empty()) {
+            if(game.board.get_check(game.to_move)) return GameRecord{loss, plies, "checkmate"};
+            return GameRecord{Outcome::Draw, plies, "stalemate"};
+        }
+        if(game.board.get_halfmove_clock() >= FIFTY_MOVE_PLIES) return GameRecord{Outcome::Draw, plies, "fifty-move rule"};
+        uint64_t key = game.board.key(game.to_move);
+        if(std::count(game.history.begin(), game.history.end(), key) >= 2) return GameRecord{Outcome::Draw, plies, "threefold repetition"};
+
+        EnginePlayer *player = (game.to_move == Team::Alpha) == a_is_alpha ? engine_a.get() : engine_b.get();
+        QElapsedTimer thinking;
+        thinking.start();
+        std::optional<Move> move = player->choose(game);
+        if(game.timed) {
+            game.clock[game.to_move] -= thinking.elapsed();
+            if(game.clock[game.to_move] <= 0) return GameRecord{loss, plies, "time forfeit"};
+            game.clock[game.to_move] += game.increment;
+        }
+        if(!move || !game.board.legal_move(*move)) return GameRecord{loss, plies, "no legal move from engine"};
+        game.history.push_back(key);
+        game.moves << QString::fromStdString(ChessBoard::move_to_string(*move));
+        game.board.do_move(*move);
+        game.to_move = team_inverse(game.to_move);
+    }
+    return GameRecord{Outcome::Draw, settings.max_plies, "move limit"};
+}
+
+void Tournament::record(int index, const QString &opening, bool a_is_alpha, const GameRecord &game) {
+    QMutexLocker locker(&mutex);
+    if(game.outcome == Outcome::Aborted) {
+        if(game.reason != "stopped") fprintf(stderr, "game %d aborted: %s\n", index, qPrintable(game.reason));
+        return;
+    }
+    played++;
+    const char *result = "1/2-1/2";
+    if(game.outcome == Outcome::AlphaWins) result = "1-0";
+    if(game.outcome == Outcome::BetaWins) result = "0-1";
+    bool a_won = (game.outcome == Outcome::AlphaWins && a_is_alpha) || (game.outcome == Outcome::BetaWins && !a_is_alpha);
+    bool a_lost = (game.outcome == Outcome::AlphaWins && !a_is_alpha) || (game.outcome == Outcome::BetaWins && a_is_alpha);
+    if(a_won) wins++;
+    else if(a_lost) losses++;
+    else draws++;
+
+    if(!settings.results_path.isEmpty()) {
+        QFile results(settings.results_path);
+        if(results.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            QString colour = a_is_alpha ? "white" : "black";
+            results.write(QString("%1,%2,%3,%4,%5,%6\n").arg(index).arg(opening).arg(colour).arg(QString(result))
+                          .arg(game.plies).arg(game.reason).toUtf8());
+        }
+    }
+    printf("game %d: %s (%s, %d plies)\n", index, result, qPrintable(game.reason), game.plies);
+    print_status();
+
+    if(settings.use_sprt && !stop) {
+        Sprt::Decision decision = settings.sprt.decide(wins, draws, losses);
+        if(decision != Sprt::Decision::Continue) {
+            printf("SPRT: %s accepted\n", decision == Sprt::Decision::AcceptH1 ? "H1" : "H0");
+            stop = true;
+        }
+    }
+    fflush(stdout);
+}
+
+void Tournament::print_status() {
+    int games = wins + draws + losses;
+    double score = games ? (wins + draws * 0.5) / games : 0.5;
+    double elo = score <= 0 || score >= 1 ? (score <= 0 ? -INFINITY : INFINITY) : -400 * std::log10(1 / score - 1);
+    printf("  A: +%d =%d -%d  score %.3f  elo %+.1f", wins, draws, losses, score, elo);
+    if(settings.use_sprt) {
+        printf("  llr %.2f [%.2f, %.2f]", settings.sprt.llr(wins, draws, losses), settings.sprt.lower_bound(), settings.sprt.upper_bound());
+    }
+    printf("\n");
+}
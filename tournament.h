@@ -0,0 +1,110 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "chessboard.h"
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+    Headless engine matches. Two engines play every opening twice with
+    colours swapped, one game per worker thread, until the game budget is
+    spent or the SPRT reaches a decision.
+
+    An engine is either "local" (this build, searched in-process) or an
+    analysis server of another build, "socket:<name>" or "tcp:<port>",
+    spoken to over the chess_server JSON-line protocol.
+*/
+
+//sequential probability ratio test on game results, Elo hypotheses in logistic Elo
+struct Sprt {
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+
+    enum class Decision {
+        Continue,
+        AcceptH0,//no better than elo0
+        AcceptH1//at least elo1
+    };
+    double llr(int wins, int draws, int losses) const;
+    double lower_bound() const;
+    double upper_bound() const;
+    Decision decide(int wins, int draws, int losses) const;
+};
+
+struct MatchSettings {
+    QString engine_a = "local";
+    QString engine_b = "local";
+    SearchLimits limits;
+    int64_t base_time = 0;//milliseconds per side for the game, 0 to play without a clock
+    int64_t increment = 0;//milliseconds added after each move
+    int hash_megabytes = 16;//per local engine instance
+    int concurrency = 1;
+    int games = 1000;
+    int max_plies = 300;//longer games are adjudicated as draws
+    QStringList openings;//FENs
+    QString results_path;//one line per finished game, empty for none
+    Sprt sprt;
+    bool use_sprt = true;
+};
+
+//a game in progress, as the engines are given it
+struct GamePosition {
+    ChessBoard board;
+    Team to_move = Team::Alpha;
+    std::vector<uint64_t> history;//key of the position before each move played
+    QString start_fen;
+    QStringList moves;//coordinate notation
+    int64_t clock[2] = {0, 0};//milliseconds left by Team, unused without a clock
+    int64_t increment = 0;
+    bool timed = false;
+};
+
+class EnginePlayer
+{
+public:
+    virtual ~EnginePlayer() = default;
+    virtual std::optional<Move> choose(const GamePosition &game) = 0;
+    static std::unique_ptr<EnginePlayer> create(const QString &spec, const MatchSettings &settings);
+};
+
+class Tournament
+{
+public:
+    explicit Tournament(const MatchSettings &settings);
+    int run();//returns a process exit code
+
+private:
+    enum class Outcome {
+        AlphaWins,
+        BetaWins,
+        Draw,
+        Aborted//engine unreachable or match stopped, not counted
+    };
+    struct GameRecord {
+        Outcome outcome;
+        int plies;
+        QString reason;
+    };
+
+    MatchSettings settings;
+    QMutex mutex;
+    int wins;//counted for engine A
+    int draws;
+    int losses;
+    int played;
+    std::atomic<bool> stop;
+
+    GameRecord play(const QString &opening, bool a_is_alpha);
+    void record(int index, const QString &opening, bool a_is_alpha, const GameRecord &game);
+    void print_status();
+};
+
+#endif // TOURNAMENT_H
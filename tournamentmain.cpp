@@ -0,0 +1,107 @@
+#include "tournament.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+//balanced starting points so that deterministic engines do not replay the same game
+static QStringList default_openings() {
+    return {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+        "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1",
+        "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq - 0 2",
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("chess_tournament");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless engine-vs-engine matches with an SPRT stopping rule");
+    parser.addHelpOption();
+    QCommandLineOption engine_a_option("engine-a", "First engine: local, socket:<name> or tcp:<port>.", "spec", "local");
+    QCommandLineOption engine_b_option("engine-b", "Second engine: local, socket:<name> or tcp:<port>.", "spec", "local");
+    QCommandLineOption depth_option("depth", "Search depth per move.", "plies");
+    QCommandLineOption nodes_option("nodes", "Node budget per move.", "count");
+    QCommandLineOption movetime_option("movetime", "Time budget per move.", "ms");
+    QCommandLineOption tc_option("tc", "Game clock per side, base seconds plus increment, e.g. 10+0.1.", "base+inc");
+    QCommandLineOption hash_option("hash", "Transposition table size per local engine.", "MB", "16");
+    QCommandLineOption concurrency_option("concurrency", "Games played at once.", "count", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption games_option("games", "Maximum number of games.", "count", "1000");
+    QCommandLineOption max_plies_option("max-plies", "Adjudicate longer games as draws.", "plies", "300");
+    QCommandLineOption openings_option("openings", "File with one opening FEN per line.", "file");
+    QCommandLineOption results_option("results", "Write one CSV line per finished game.", "file");
+    QCommandLineOption elo0_option("elo0", "SPRT null hypothesis Elo.", "elo", "0");
+    QCommandLineOption elo1_option("elo1", "SPRT alternative hypothesis Elo.", "elo", "5");
+    QCommandLineOption alpha_option("alpha", "SPRT false positive rate.", "p", "0.05");
+    QCommandLineOption beta_option("beta", "SPRT false negative rate.", "p", "0.05");
+    QCommandLineOption no_sprt_option("no-sprt", "Play the full game budget.");
+    parser.addOptions({engine_a_option, engine_b_option, depth_option, nodes_option, movetime_option, tc_option, hash_option,
+                       concurrency_option, games_option, max_plies_option, openings_option, results_option,
+                       elo0_option, elo1_option, alpha_option, beta_option, no_sprt_option});
+    parser.process(a);
+
+    MatchSettings settings;
+    settings.engine_a = parser.value(engine_a_option);
+    settings.engine_b = parser.value(engine_b_option);
+    settings.limits.depth = parser.value(depth_option).toInt();
+    settings.limits.nodes = parser.value(nodes_option).toLongLong();
+    settings.limits.movetime = parser.value(movetime_option).toLongLong();
+    if(parser.isSet(tc_option)) {
+        QStringList tc = parser.value(tc_option).split('+');
+        bool base_ok = false, increment_ok = true;
+        settings.base_time = std::llround(tc[0].toDouble(&base_ok) * 1000);
+        if(tc.size() > 1) settings.increment = std::llround(tc[1].toDouble(&increment_ok) * 1000);
+        if(tc.size() > 2 || !base_ok || !increment_ok || settings.base_time <= 0 || settings.increment < 0) {
+            fprintf(stderr, "--tc expects base seconds and an optional increment, e.g. 10+0.1\n");
+            return 1;
+        }
+    }
+    if(settings.limits.depth <= 0 && settings.limits.nodes <= 0 && settings.limits.movetime <= 0 && settings.base_time <= 0) settings.limits.depth = 4;
+    settings.hash_megabytes = std::max(1, parser.value(hash_option).toInt());
+    settings.concurrency = std::max(1, parser.value(concurrency_option).toInt());
+    settings.games = std::max(0, parser.value(games_option).toInt());
+    settings.max_plies = std::max(1, parser.value(max_plies_option).toInt());
+    settings.results_path = parser.value(results_option);
+    settings.sprt.elo0 = parser.value(elo0_option).toDouble();
+    settings.sprt.elo1 = parser.value(elo1_option).toDouble();
+    settings.sprt.alpha = parser.value(alpha_option).toDouble();
+    settings.sprt.beta = parser.value(beta_option).toDouble();
+    settings.use_sprt = !parser.isSet(no_sprt_option);
+
+    if(parser.isSet(openings_option)) {
+        QFile file(parser.value(openings_option));
+        if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            fprintf(stderr, "could not open %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        while(!file.atEnd()) {
+            QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if(!line.isEmpty() && !line.startsWith('#')) settings.openings << line;
+        }
+    } else {
+        settings.openings = default_openings();
+    }
+    for(const QString &opening : settings.openings) {
+        if(!ChessBoard::from_fen(opening.toStdString())) {
+            fprintf(stderr, "invalid opening: %s\n", qPrintable(opening));
+            return 1;
+        }
+    }
+
+    Tournament tournament(settings);
+    return tournament.run();
+}
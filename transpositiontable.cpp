@@ -0,0 +1,179 @@
+#include "transpositiontable.h"
+#include "zobrist.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const char FILE_MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'T', 'T', '\0'};
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    header = nullptr;
+    allocate(megabytes);
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes, const QString &path, Mapping mapping) : file(path) {
+    header = nullptr;
+    if(path.isEmpty()) allocate(megabytes);
+    else if(!map_file(megabytes, mapping)) {
+        error = file.errorString();
+        file.close();
+        header = nullptr;
+        allocate(megabytes);
+    }
+}
+
+size_t TranspositionTable::slot_count(size_t megabytes) {
+    size_t count = 1;
+    while(count * 2 * sizeof(Slot) <= std::max<size_t>(megabytes, 1) * 1024 * 1024) count *= 2;
+    return count;
+}
+
+void TranspositionTable::allocate(size_t megabytes) {
+    size_t count = slot_count(megabytes);
+    heap_slots = std::make_unique<Slot[]>(count);
+    slots = heap_slots.get();
+    mask = count - 1;
+    generation = 1;//packed data of zero marks an empty slot
+    clear();
+}
+
+bool TranspositionTable::map_file(size_t megabytes, Mapping mapping) {
+    static_assert(sizeof(FileHeader) <= FILE_SLOTS_OFFSET, "header overlaps the slots");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "slots must be lock free to be shared between processes");
+    uint64_t key_check = ZOBRIST_KEYS.beta_to_move ^ ZOBRIST_KEYS.piece[1][5][63];
+
+    bool shared = mapping == Mapping::Shared;
+    if(!file.open(shared ? QIODevice::ReadWrite : QIODevice::ReadOnly)) return false;
+
+    //an existing table is reused only if it was written with the same layout and keys
+    FileHeader existing{};
+    bool valid = file.size() >= FILE_SLOTS_OFFSET
+                 && file.read(reinterpret_cast<char *>(&existing), sizeof(FileHeader)) == sizeof(FileHeader)
+                 && std::memcmp(existing.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0
+                 && existing.version == FILE_VERSION
+                 && existing.slot_size == sizeof(Slot)
+                 && existing.key_check == key_check
+                 && existing.slot_count > 0 && (existing.slot_count & (existing.slot_count - 1)) == 0
+                 && file.size() == static_cast<qint64>(FILE_SLOTS_OFFSET + existing.slot_count * sizeof(Slot));
+    if(!valid && !shared) {
+        file.setErrorString("not a transposition table file");
+        return false;
+    }
+
+    size_t count = valid ? existing.slot_count : slot_count(megabytes);
+    qint64 bytes = FILE_SLOTS_OFFSET + count * sizeof(Slot);
+    if(!valid && !file.resize(bytes)) return false;
+    uchar * memory = file.map(0, bytes, shared ? QFileDevice::NoOptions : QFileDevice::MapPrivateOption);
+    if(!memory) return false;
+
+    header = reinterpret_cast<FileHeader *>(memory);
+    slots = reinterpret_cast<Slot *>(memory + FILE_SLOTS_OFFSET);
+    mask = count - 1;
+    if(!valid) {
+        //zero the slots before the header marks the file as a table
+        clear();
+        std::memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header->version = FILE_VERSION;
+        header->slot_size = sizeof(Slot);
+        header->slot_count = count;
+        header->key_check = key_check;
+        header->generation.store(1, std::memory_order_relaxed);
+    }
+    //start past the stored generation so the old entries are the first to be replaced
+    generation = static_cast<uint8_t>(header->generation.load(std::memory_order_relaxed) + 1);
+    if(generation == 0) generation = 1;
+    header->generation.store(generation, std::memory_order_relaxed);
+    return true;
+}
+
+bool TranspositionTable::is_mapped() const {
+    return header != nullptr;
+}
+
+QString TranspositionTable::error_string() const {
+    return error;
+}
+
+//score 32 bits | depth 8 | bound 2 | origin 6 | destination 6 | has move 1 | generation 8
+uint64_t TranspositionTable::pack(const Entry &entry, uint8_t generation) {
+    uint64_t data = static_cast<uint32_t>(entry.score);
+    data |= static_cast<uint64_t>(std::clamp(entry.depth, 0, 255)) << 32;
+    data |= static_cast<uint64_t>(entry.bound) << 40;
+    if(entry.move_origin >= 0) {
+        data |= static_cast<uint64_t>(entry.move_origin) << 42;
+        data |= static_cast<uint64_t>(entry.move_destination) << 48;
+        data |= 1ull << 54;
+    }
+    data |= static_cast<uint64_t>(generation) << 56;
+    return data;
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(uint64_t data) {
+    Entry entry;
+    entry.score = static_cast<int32_t>(data & 0xFFFFFFFF);
+    entry.depth = (data >> 32) & 0xFF;
+    entry.bound = static_cast<Bound>((data >> 40) & 3);
+    if(data & (1ull << 54)) {
+        entry.move_origin = (data >> 42) & 63;
+        entry.move_destination = (data >> 48) & 63;
+    }
+    else {
+        entry.move_origin = -1;
+        entry.move_destination = -1;
+    }
+    return entry;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry &entry) const {
+    const Slot &slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if(data == 0 || (check ^ data) != key) return false;
+    entry = unpack(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const Entry &entry) {
+    Slot &slot = slots[key & mask];
+    uint8_t current = generation.load(std::memory_order_relaxed);
+    uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+    uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+    bool same_key = old_data != 0 && (old_check ^ old_data) == key;
+
+    Entry merged = entry;
+    if(old_data != 0 && (old_data >> 56) == current) {
+        //within one search keep the deeper result unless this one is exact for the same position
+        Entry old = unpack(old_data);
+        if(old.depth > entry.depth && !(same_key && entry.bound == Bound::Exact)) return;
+    }
+    if(same_key && merged.move_origin < 0) {
+        Entry old = unpack(old_data);
+        merged.move_origin = old.move_origin;
+        merged.move_destination = old.move_destination;
+    }
+
+    uint64_t data = pack(merged, current);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::new_search() {
+    //wrapping skips 0, which would make the new entries look empty
+    uint8_t current = generation.load(std::memory_order_relaxed);
+    uint8_t next;
+    do {
+        next = current == UINT8_MAX ? 1 : current + 1;
+    } while(!generation.compare_exchange_weak(current, next, std::memory_order_relaxed));
+    if(header) header->generation.store(next, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for(size_t i = 0; i <= mask; i++) {
+        slots[i].data.store(0, std::memory_order_relaxed);
+        slots[i].check.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t TranspositionTable::size_bytes() const {
+    return (mask + 1) * sizeof(Slot);
+}
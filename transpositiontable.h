@@ -0,0 +1,86 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+    Shared hash of search results, safe to probe and store from several
+    search threads at once. Each slot keeps the key xor'd with its data
+    so a torn write just reads back as a miss.
+
+    The table can live in a memory-mapped file instead of the heap, so it
+    survives restarts and is shared by every process mapping the same file.
+    A private mapping starts from the file's contents but keeps its own
+    stores, for processes that should use a warm table without feeding it.
+*/
+
+class TranspositionTable
+{
+public:
+    enum class Bound {
+        Exact,
+        Lower,//score >= stored
+        Upper//score <= stored
+    };
+    struct Entry {
+        int score;
+        int depth;//plies searched below the node
+        Bound bound;
+        int move_origin;//x + y*8, -1 if no move was stored
+        int move_destination;
+    };
+
+    enum class Mapping {
+        Shared,//stores reach the file and other processes
+        Private//copy on write, the file is only read
+    };
+
+    explicit TranspositionTable(size_t megabytes);
+    //megabytes sizes a new file, an existing valid one keeps its size; an empty path or a file that can't be used falls back to the heap
+    TranspositionTable(size_t megabytes, const QString &path, Mapping mapping = Mapping::Shared);
+    bool is_mapped() const;
+    QString error_string() const;
+    bool probe(uint64_t key, Entry &entry) const;
+    void store(uint64_t key, const Entry &entry);
+    void new_search();
+    void clear();
+    size_t size_bytes() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;//key ^ data
+        std::atomic<uint64_t> data;
+    };
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slot_size;
+        uint64_t slot_count;
+        uint64_t key_check;//changes with the Zobrist keys, which would make every entry wrong
+        std::atomic<uint32_t> generation;
+    };
+    static const int FILE_VERSION = 1;
+    static const int FILE_SLOTS_OFFSET = 64;
+
+    std::unique_ptr<Slot[]> heap_slots;
+    Slot * slots;
+    size_t mask;
+    std::atomic<uint8_t> generation;
+    QFile file;
+    FileHeader * header;//in the mapping, null on the heap
+    QString error;
+
+    void allocate(size_t megabytes);
+    bool map_file(size_t megabytes, Mapping mapping);
+    static size_t slot_count(size_t megabytes);
+
+    static uint64_t pack(const Entry &entry, uint8_t generation);
+    static Entry unpack(uint64_t data);
+};
+
+#endif // TRANSPOSITIONTABLE_H
@@ -0,0 +1,67 @@
+#include "texeltuner.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstdio>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("chess_tune");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Texel tuning of the evaluation weights on labelled positions");
+    parser.addHelpOption();
+    parser.addPositionalArgument("positions", "File with one \"<fen> <result>\" per line.");
+    QCommandLineOption k_option("k", "Sigmoid scale, fitted to the default weights when omitted.", "k");
+    QCommandLineOption weights_option("weights", "Comma separated weights to tune, all by default.", "names");
+    QCommandLineOption passes_option("passes", "Maximum local search passes.", "count", "100");
+    QCommandLineOption batch_option("batch", "Lines read per parallel batch.", "lines", "65536");
+    QCommandLineOption threads_option("threads", "Evaluation threads.", "count", QString::number(QThreadPool::globalInstance()->maxThreadCount()));
+    parser.addOptions({k_option, weights_option, passes_option, batch_option, threads_option});
+    parser.process(a);
+
+    if(parser.positionalArguments().size() != 1) parser.showHelp(1);
+    QThreadPool::globalInstance()->setMaxThreadCount(std::max(1, parser.value(threads_option).toInt()));
+    TexelTuner tuner(parser.positionalArguments().first(), parser.value(batch_option).toInt());
+    EvalParams params;
+
+    std::vector<int> indices;
+    if(parser.isSet(weights_option)) {
+        for(const QString &name : parser.value(weights_option).split(',')) {
+            int index = 0;
+            while(index < EvalParams::Count && name.trimmed() != EvalParams::name(index)) index++;
+            if(index == EvalParams::Count) {
+                fprintf(stderr, "unknown weight %s\n", qPrintable(name));
+                return 1;
+            }
+            indices.push_back(index);
+        }
+    } else {
+        for(int index = 0; index < EvalParams::Count; index++) indices.push_back(index);
+    }
+
+    double k = parser.value(k_option).toDouble();
+    if(!parser.isSet(k_option)) {
+        k = tuner.fit_k(params);
+        if(k < 0) {
+            fprintf(stderr, "no labelled positions in %s\n", qPrintable(parser.positionalArguments().first()));
+            return 1;
+        }
+        printf("k = %.2f\n", k);
+    }
+
+    params = tuner.tune(params, k, indices, std::max(1, parser.value(passes_option).toInt()));
+    if(tuner.positions() == 0) {
+        fprintf(stderr, "no labelled positions in %s\n", qPrintable(parser.positionalArguments().first()));
+        return 1;
+    }
+    printf("%lld positions (%lld skipped), %lld evaluations\n", static_cast<long long>(tuner.positions()),
+           static_cast<long long>(tuner.skipped()), static_cast<long long>(tuner.evaluations()));
+    printf("weights = {");
+    for(int index = 0; index < EvalParams::Count; index++) printf(index ? ", %d" : "%d", params.weights[index]);
+    printf("}\n");
+    return 0;
+}
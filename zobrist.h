@@ -0,0 +1,46 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+/*
+    Zobrist keys for position hashing, generated at compile time from a
+    fixed seed so keys are identical across builds and processes.
+    Indexed [team][rank][x + y*8] like the piece-square tables.
+*/
+
+struct ZobristKeys {
+    uint64_t piece[2][6][64];
+    uint64_t castle[16];
+    uint64_t beta_to_move;
+};
+
+constexpr uint64_t zobrist_next(uint64_t &state) {
+    //splitmix64
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys make_zobrist_keys() {
+    ZobristKeys keys{};
+    uint64_t state = 0x43686573734B6579ull;
+    for(int team = 0; team < 2; team++) {
+        for(int rank = 0; rank < 6; rank++) {
+            for(int square = 0; square < 64; square++) {
+                keys.piece[team][rank][square] = zobrist_next(state);
+            }
+        }
+    }
+    for(int i = 0; i < 16; i++) {
+        keys.castle[i] = i == 0 ? 0 : zobrist_next(state);
+    }
+    keys.beta_to_move = zobrist_next(state);
+    return keys;
+}
+
+inline constexpr ZobristKeys ZOBRIST_KEYS = make_zobrist_keys();
+
+#endif // ZOBRIST_H